@@ -0,0 +1,325 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2023 Mathieu Rabine
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// bench.
+#include "bench.h"
+
+// C.
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+
+#if defined (__linux__)
+#include <linux/perf_event.h>
+#endif
+
+/// key distributions.
+enum { SEQUENTIAL, RANDOM, ZIPF, DUPLICATE, DISTRIBUTIONS };
+
+static const char* distributions[DISTRIBUTIONS] = {"sequential", "random", "zipf", "duplicate"};
+
+/**
+ * @brief hardware counters, -1 when not available.
+ */
+struct counters
+{
+    int  cycles;                // cpu cycles counter.
+    int  misses;                // cache misses counter.
+};
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : next_random
+// =========================================================================
+uint64_t next_random (uint64_t* state)
+{
+    // splitmix64.
+    uint64_t z = (*state += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : make_keys
+// =========================================================================
+long* make_keys (int dist, size_t n, uint64_t seed)
+{
+    long* keys = malloc (n * sizeof (long));
+
+    if (keys == NULL)
+    {
+        return NULL;
+    }
+
+    // zipf with s = 0.99 over n ranks, after Gray et al., ranks are scrambled over the key space.
+    double theta = 0.99;
+    double zetan = 0, zeta2 = 1 + pow (0.5, theta);
+    if (dist == ZIPF)
+    {
+        for (size_t i = 1; i <= n; ++i)
+            zetan += 1 / pow ((double)i, theta);
+    }
+    double alpha = 1 / (1 - theta);
+    double eta = (1 - pow (2.0 / n, 1 - theta)) / (1 - zeta2 / zetan);
+
+    for (size_t i = 0; i < n; ++i)
+    {
+        uint64_t r = next_random (&seed);
+
+        switch (dist)
+        {
+        case SEQUENTIAL:
+            keys[i] = (long)i;
+            break;
+        case RANDOM:
+            keys[i] = (long)(r >> 1);
+            break;
+        case ZIPF:
+        {
+            double u = (r >> 11) * (1.0 / 9007199254740992.0);
+            double uz = u * zetan;
+            uint64_t rank = (uz < 1) ? 0 : (uz < zeta2) ? 1 : (uint64_t)(n * pow (eta * u - eta + 1, alpha));
+            uint64_t s = rank;
+            keys[i] = (long)(next_random (&s) >> 1);
+            break;
+        }
+        case DUPLICATE:
+            keys[i] = (long)(r % (n / 16 + 1));
+            break;
+        }
+    }
+
+    return keys;
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : open_counter
+// =========================================================================
+int open_counter (unsigned long long config)
+{
+#if defined (__linux__)
+    struct perf_event_attr attr;
+
+    memset (&attr, 0, sizeof (attr));
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof (attr);
+    attr.config = config;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+
+    return (int)syscall (SYS_perf_event_open, &attr, 0, -1, -1, 0);
+#else
+    (void) config;
+    return -1;
+#endif
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : start_counter
+// =========================================================================
+void start_counter (int fd)
+{
+#if defined (__linux__)
+    if (fd >= 0)
+    {
+        ioctl (fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl (fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+#endif
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : stop_counter
+// =========================================================================
+long long stop_counter (int fd)
+{
+    long long value = -1;
+
+#if defined (__linux__)
+    if (fd >= 0)
+    {
+        ioctl (fd, PERF_EVENT_IOC_DISABLE, 0);
+        if (read (fd, &value, sizeof (value)) != sizeof (value))
+            value = -1;
+    }
+#endif
+
+    return value;
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : now_ns
+// =========================================================================
+double now_ns (void)
+{
+    struct timespec ts;
+
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : report
+// =========================================================================
+void report (const struct bench_ops* ops, int dist, size_t n, const char* op, size_t count, double ns, long long cycles, long long misses)
+{
+    struct rusage usage;
+
+    getrusage (RUSAGE_SELF, &usage);
+
+    printf ("{\"container\": \"%s\", \"keys\": \"%s\", \"size\": %zu, \"op\": \"%s\", \"ops\": %zu, \"ns_per_op\": %.2f",
+            ops->name, distributions[dist], n, op, count, ns / count);
+
+    if (cycles >= 0)
+        printf (", \"cycles_per_op\": %.2f", (double)cycles / count);
+    else
+        printf (", \"cycles_per_op\": null");
+
+    if (misses >= 0)
+        printf (", \"cache_misses_per_op\": %.3f", (double)misses / count);
+    else
+        printf (", \"cache_misses_per_op\": null");
+
+    printf (", \"peak_rss_kb\": %ld}\n", usage.ru_maxrss);
+    fflush (stdout);
+}
+
+/// run one measured phase.
+#define MEASURE(name, count, body)                                                              \
+    do                                                                                          \
+    {                                                                                           \
+        start_counter (counters.cycles);                                                        \
+        start_counter (counters.misses);                                                        \
+        double start = now_ns ();                                                               \
+        body;                                                                                   \
+        double ns = now_ns () - start;                                                          \
+        long long cycles = stop_counter (counters.cycles);                                      \
+        long long misses = stop_counter (counters.misses);                                      \
+        report (ops, dist, n, name, count, ns, cycles, misses);                                 \
+    }                                                                                           \
+    while (0)
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : run_workloads
+// =========================================================================
+void run_workloads (const struct bench_ops* ops, int dist, size_t n)
+{
+    struct counters counters = {open_counter (PERF_COUNT_HW_CPU_CYCLES), open_counter (PERF_COUNT_HW_CACHE_MISSES)};
+    long* keys = make_keys (dist, n, 42);
+    long* probes = make_keys (dist, n, 43);
+    void* ctx = ops->create ();
+    volatile long sink = 0;
+
+    if (keys == NULL || probes == NULL || ctx == NULL)
+    {
+        fprintf (stderr, "%s: out of memory for %zu keys\n", ops->name, n);
+        exit (1);
+    }
+
+    MEASURE ("insert", n, for (size_t i = 0; i < n; ++i) sink += ops->insert (&keys[i], ctx));
+
+    MEASURE ("find", n, for (size_t i = 0; i < n; ++i) sink += ops->find (&keys[(i * 7919) % n], ctx));
+
+    MEASURE ("iterate", n, sink += ops->iterate (ctx));
+
+    // half lookups, a quarter inserts and a quarter removals of keys from the same distribution.
+    MEASURE ("mixed", n, for (size_t i = 0; i < n; ++i)
+    {
+        switch (i & 3)
+        {
+        case 0:
+            sink += ops->insert (&probes[i], ctx);
+            break;
+        case 1:
+            ops->remove (&probes[i - 1], ctx);
+            break;
+        default:
+            sink += ops->find (&keys[i], ctx);
+            break;
+        }
+    });
+
+    // write only, every key is removed then inserted back so the size stays the same.
+    MEASURE ("churn", n, for (size_t i = 0; i < n; ++i)
+    {
+        ops->remove (&keys[i], ctx);
+        sink += ops->insert (&keys[i], ctx);
+    });
+
+    MEASURE ("remove", n, for (size_t i = 0; i < n; ++i) ops->remove (&keys[i], ctx));
+
+    ops->destroy (ctx);
+    free (probes);
+    free (keys);
+    (void) sink;
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : bench_run
+// =========================================================================
+void bench_run (const struct bench_ops* ops, size_t max_size)
+{
+    for (int dist = 0; dist < DISTRIBUTIONS; ++dist)
+    {
+        for (size_t n = 1000; n <= max_size; n *= 10)
+        {
+            pid_t pid = fork ();
+
+            if (pid == 0)
+            {
+                run_workloads (ops, dist, n);
+                fflush (stdout);
+                _exit (0);
+            }
+
+            if (pid > 0)
+            {
+                waitpid (pid, NULL, 0);
+            }
+            else
+            {
+                run_workloads (ops, dist, n);
+            }
+        }
+    }
+}
@@ -0,0 +1,62 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2023 Mathieu Rabine
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _BENCH_H_
+#define _BENCH_H_
+
+// C.
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief container under benchmark, keys are pointers into an array owned by the harness.
+ */
+struct bench_ops
+{
+    const char*  name;                                  // container name.
+    void*        (*create)  (void);                     // create an empty container.
+    void         (*destroy) (void* ctx);                // delete the container.
+    int          (*insert)  (const long* key, void* ctx);// insert key, 0 if already there.
+    int          (*find)    (const long* key, void* ctx);// 1 if key is found.
+    void         (*remove)  (const long* key, void* ctx);// remove key.
+    long         (*iterate) (void* ctx);                // visit keys in order, return their sum.
+};
+
+/**
+ * @brief run all workloads of a container.
+ * @param ops container.
+ * @param max_size largest number of keys.
+ * @note each distribution and size runs in its own process so that peak RSS is per run, every
+ * measure is printed as one json object per line.
+ */
+void bench_run (const struct bench_ops* ops, size_t max_size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,74 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2023 Mathieu Rabine
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// bench.
+#include "bench.h"
+
+// C++.
+#include <map>
+
+namespace
+{
+    typedef std::map<long, const long*> map_type;
+
+    void* map_create ()
+    {
+        return new map_type ();
+    }
+
+    void map_destroy (void* ctx)
+    {
+        delete static_cast<map_type*> (ctx);
+    }
+
+    int map_insert (const long* key, void* ctx)
+    {
+        return static_cast<map_type*> (ctx)->emplace (*key, key).second;
+    }
+
+    int map_find (const long* key, void* ctx)
+    {
+        map_type* map = static_cast<map_type*> (ctx);
+        return map->find (*key) != map->end ();
+    }
+
+    void map_remove (const long* key, void* ctx)
+    {
+        static_cast<map_type*> (ctx)->erase (*key);
+    }
+
+    long map_iterate (void* ctx)
+    {
+        unsigned long sum = 0;
+
+        for (const auto& entry : *static_cast<map_type*> (ctx))
+        {
+            sum += static_cast<unsigned long> (entry.first);
+        }
+
+        return static_cast<long> (sum);
+    }
+}
+
+extern "C" const struct bench_ops map_ops = {"std::map", map_create, map_destroy, map_insert, map_find, map_remove, map_iterate};
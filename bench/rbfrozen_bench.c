@@ -0,0 +1,111 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2023 Mathieu Rabine
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// rbtree.
+#include <rbfrozen.h>
+
+// C.
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+int compare (const void* left, const void* right)
+{
+    return (*(long*)(left) == *(long*)(right)) ? 0 : ((*(long*)(left) < *(long*)(right)) ? -1 : 1);
+}
+
+double now_ns (void)
+{
+    struct timespec ts;
+
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/*
+ * lookups of random present keys in a tree, in its frozen snapshot and in the integer key index
+ * of the snapshot for each supported instruction set, for growing sizes, one json object per line.
+ */
+int main (int argc, char** argv)
+{
+    size_t max_size = (argc > 1) ? strtoull (argv[1], NULL, 10) : 10000000;
+    unsigned int seed = 1;
+
+    for (size_t n = 1000; n <= max_size; n *= 10)
+    {
+        long* keys = malloc (n * sizeof (long));
+        size_t* probes = malloc (n * sizeof (size_t));
+        struct rbtree* tree = rb_new (compare, NULL);
+        volatile size_t found = 0;
+
+        for (size_t i = 0; i < n; ++i)
+        {
+            keys[i] = ((long)rand_r (&seed) << 31) | rand_r (&seed);
+            rb_insert (&keys[i], tree);
+            probes[i] = (size_t)rand_r (&seed) % n;
+        }
+
+        struct rbfrozen* frozen = rb_freeze (tree);
+
+        double start = now_ns ();
+        for (size_t i = 0; i < n; ++i)
+            found += rb_find (&keys[probes[i]], tree) != NULL;
+        double tree_ns = (now_ns () - start) / n;
+
+        start = now_ns ();
+        for (size_t i = 0; i < n; ++i)
+            found += rb_frozen_find (&keys[probes[i]], frozen) != NULL;
+        double frozen_ns = (now_ns () - start) / n;
+
+        printf ("{\"bench\": \"find\", \"size\": %zu, \"rb_find_ns\": %.2f, \"rb_frozen_find_ns\": %.2f",
+                n, tree_ns, frozen_ns);
+
+        // integer key index, for each instruction set.
+        const char* names[] = {"", "scalar", "sse", "avx2"};
+
+        for (int simd = RB_SIMD_NONE; simd <= RB_SIMD_AVX2; ++simd)
+        {
+            rb_frozen_index (RB_KEY_I64, 0, simd, frozen);
+
+            start = now_ns ();
+            for (size_t i = 0; i < n; ++i)
+                found += rb_frozen_find_i64 (keys[probes[i]], frozen) != NULL;
+            double index_ns = (now_ns () - start) / n;
+
+            if (frozen->simd == simd)
+                printf (", \"rb_frozen_find_i64_%s_ns\": %.2f", names[simd], index_ns);
+        }
+
+        printf ("}\n");
+        fflush (stdout);
+
+        rb_frozen_delete (frozen);
+        rb_delete (tree);
+        free (probes);
+        free (keys);
+    }
+
+    return 0;
+}
@@ -0,0 +1,134 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2023 Mathieu Rabine
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// rbtree.
+#include <rbpart.h>
+#include <rbsync.h>
+
+// C.
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define KEYS 1048576
+
+struct worker
+{
+    void*   tree;
+    int*    keys;
+    int     first;
+    int     step;
+    int     sync;
+};
+
+int compare (const void* left, const void* right)
+{
+    return (*(int*)(left) == *(int*)(right)) ? 0 : ((*(int*)(left) < *(int*)(right)) ? -1 : 1);
+}
+
+size_t hash_split (const void* data, size_t nparts, void* ctx)
+{
+    (void)ctx;
+    return ((unsigned int)*(int*)data * 2654435761u) % nparts;
+}
+
+void* run_worker (void* arg)
+{
+    struct worker* w = arg;
+
+    for (int i = w->first; i < KEYS; i += w->step)
+    {
+        if (w->sync)
+        {
+            rb_sync_insert (&w->keys[i], w->tree);
+        }
+        else
+        {
+            rb_part_insert (&w->keys[i], w->tree);
+        }
+    }
+
+    return NULL;
+}
+
+double run (void* tree, int sync, int* keys, int threads)
+{
+    pthread_t ids[threads];
+    struct worker workers[threads];
+    struct timespec start, end;
+
+    clock_gettime (CLOCK_MONOTONIC, &start);
+
+    for (int i = 0; i < threads; ++i)
+    {
+        workers[i] = (struct worker){tree, keys, i, threads, sync};
+        pthread_create (&ids[i], NULL, run_worker, &workers[i]);
+    }
+
+    for (int i = 0; i < threads; ++i)
+    {
+        pthread_join (ids[i], NULL);
+    }
+
+    clock_gettime (CLOCK_MONOTONIC, &end);
+
+    double ns = (end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec);
+
+    return KEYS * 1e3 / ns;
+}
+
+/*
+ * insert throughput of a partitioned tree against a single locked tree, for a growing
+ * number of threads, one json object per line in Mops/s.
+ */
+int main (int argc, char** argv)
+{
+    int max_threads = (argc > 1) ? atoi (argv[1]) : 8;
+    int* keys = malloc (KEYS * sizeof (int));
+    unsigned int seed = 1;
+
+    for (int i = 0; i < KEYS; ++i)
+    {
+        keys[i] = rand_r (&seed);
+    }
+
+    for (int threads = 1; threads <= max_threads; threads *= 2)
+    {
+        struct rbsync* sync = rb_sync_new (compare, NULL);
+        struct rbpart* part = rb_part_new (compare, NULL, 4 * threads, hash_split, NULL);
+
+        printf ("{\"bench\": \"insert\", \"tree\": \"rbsync\", \"threads\": %d, \"mops\": %.3f}\n",
+                threads, run (sync, 1, keys, threads));
+        printf ("{\"bench\": \"insert\", \"tree\": \"rbpart\", \"threads\": %d, \"mops\": %.3f}\n",
+                threads, run (part, 0, keys, threads));
+        fflush (stdout);
+
+        rb_sync_delete (sync);
+        rb_part_delete (part);
+    }
+
+    free (keys);
+
+    return 0;
+}
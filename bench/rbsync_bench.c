@@ -0,0 +1,235 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2023 Mathieu Rabine
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// rbtree.
+#include <rbsync.h>
+
+// C.
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define KEYS      65536
+#define DURATION  200000000L
+
+/**
+ * @brief lock under test.
+ */
+struct lock
+{
+    const char*  name;
+    void*        (*find)   (const void* data, void* ctx);
+    void*        (*insert) (void* data, void* ctx);
+    void         (*remove) (const void* data, void* ctx);
+    void*        ctx;
+};
+
+/**
+ * @brief tree behind a single mutex.
+ */
+struct mutex_tree
+{
+    struct rbtree*   tree;
+    pthread_mutex_t  lock;
+};
+
+struct worker
+{
+    struct lock*  lock;
+    int*          keys;
+    int           writes;
+    int*          stop;
+    long          ops;
+};
+
+int compare (const void* left, const void* right)
+{
+    return (*(int*)(left) == *(int*)(right)) ? 0 : ((*(int*)(left) < *(int*)(right)) ? -1 : 1);
+}
+
+void* sync_find (const void* data, void* ctx)
+{
+    return rb_sync_find (data, ctx);
+}
+
+void* sync_insert (void* data, void* ctx)
+{
+    return rb_sync_insert (data, ctx);
+}
+
+void sync_remove (const void* data, void* ctx)
+{
+    rb_sync_remove (data, ctx);
+}
+
+void* mutex_find (const void* data, void* ctx)
+{
+    struct mutex_tree* mt = ctx;
+
+    pthread_mutex_lock (&mt->lock);
+    void* found = rb_find (data, mt->tree);
+    pthread_mutex_unlock (&mt->lock);
+
+    return found;
+}
+
+void* mutex_insert (void* data, void* ctx)
+{
+    struct mutex_tree* mt = ctx;
+
+    pthread_mutex_lock (&mt->lock);
+    void* inserted = rb_insert (data, mt->tree);
+    pthread_mutex_unlock (&mt->lock);
+
+    return inserted;
+}
+
+void mutex_remove (const void* data, void* ctx)
+{
+    struct mutex_tree* mt = ctx;
+
+    pthread_mutex_lock (&mt->lock);
+    rb_remove (data, mt->tree);
+    pthread_mutex_unlock (&mt->lock);
+}
+
+void* run_worker (void* arg)
+{
+    struct worker* w = arg;
+    unsigned int seed = (unsigned int)(size_t)&seed;
+    long ops = 0;
+
+    while (!__atomic_load_n (w->stop, __ATOMIC_RELAXED))
+    {
+        for (int i = 0; i < 64; ++i, ++ops)
+        {
+            int* key = &w->keys[rand_r (&seed) % KEYS];
+
+            if ((int)(rand_r (&seed) % 100) < w->writes)
+            {
+                if (w->lock->insert (key, w->lock->ctx) == NULL)
+                {
+                    w->lock->remove (key, w->lock->ctx);
+                }
+            }
+            else
+            {
+                w->lock->find (key, w->lock->ctx);
+            }
+        }
+    }
+
+    w->ops = ops;
+
+    return NULL;
+}
+
+double run (struct lock* lock, int* keys, int threads, int writes)
+{
+    pthread_t ids[threads];
+    struct worker workers[threads];
+    struct timespec start, now;
+    int stop = 0;
+    long ops = 0;
+
+    for (int i = 0; i < threads; ++i)
+    {
+        workers[i] = (struct worker){lock, keys, writes, &stop, 0};
+        pthread_create (&ids[i], NULL, run_worker, &workers[i]);
+    }
+
+    clock_gettime (CLOCK_MONOTONIC, &start);
+    do
+    {
+        struct timespec pause = {0, 10000000L};
+        nanosleep (&pause, NULL);
+        clock_gettime (CLOCK_MONOTONIC, &now);
+    }
+    while ((now.tv_sec - start.tv_sec) * 1000000000L + (now.tv_nsec - start.tv_nsec) < DURATION);
+
+    __atomic_store_n (&stop, 1, __ATOMIC_RELAXED);
+
+    for (int i = 0; i < threads; ++i)
+    {
+        pthread_join (ids[i], NULL);
+        ops += workers[i].ops;
+    }
+
+    clock_gettime (CLOCK_MONOTONIC, &now);
+
+    double ns = (now.tv_sec - start.tv_sec) * 1e9 + (now.tv_nsec - start.tv_nsec);
+
+    return ops * 1e3 / ns;
+}
+
+/*
+ * contention benchmark: a sharded reader-writer lock against a single mutex, for a
+ * growing number of threads and write ratios, one json object per line in Mops/s.
+ */
+int main (int argc, char** argv)
+{
+    int max_threads = (argc > 1) ? atoi (argv[1]) : 8;
+    int* keys = malloc (KEYS * sizeof (int));
+
+    struct rbsync* sync = rb_sync_new (compare, NULL);
+    struct mutex_tree mt = {rb_new (compare, NULL), PTHREAD_MUTEX_INITIALIZER};
+
+    struct lock locks[] =
+    {
+        {"rwlock", sync_find, sync_insert, sync_remove, sync},
+        {"mutex", mutex_find, mutex_insert, mutex_remove, &mt},
+    };
+
+    for (int i = 0; i < KEYS; ++i)
+    {
+        keys[i] = i;
+
+        if (i % 2 == 0)
+        {
+            rb_sync_insert (&keys[i], sync);
+            rb_insert (&keys[i], mt.tree);
+        }
+    }
+
+    int writes[] = {0, 1, 10, 50};
+
+    for (size_t w = 0; w < sizeof (writes) / sizeof (writes[0]); ++w)
+    {
+        for (int threads = 1; threads <= max_threads; threads *= 2)
+        {
+            for (size_t l = 0; l < sizeof (locks) / sizeof (locks[0]); ++l)
+            {
+                printf ("{\"bench\": \"contention\", \"lock\": \"%s\", \"threads\": %d, \"writes\": %d, \"mops\": %.3f}\n",
+                        locks[l].name, threads, writes[w], run (&locks[l], keys, threads, writes[w]));
+                fflush (stdout);
+            }
+        }
+    }
+
+    rb_sync_delete (sync);
+    rb_delete (mt.tree);
+    free (keys);
+
+    return 0;
+}
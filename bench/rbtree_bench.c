@@ -0,0 +1,109 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2023 Mathieu Rabine
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// bench.
+#include "bench.h"
+
+// rbtree.
+#include <rbiter.h>
+
+// C.
+#include <stdlib.h>
+#include <string.h>
+
+extern const struct bench_ops map_ops;
+
+int compare (const void* left, const void* right)
+{
+    return (*(long*)(left) == *(long*)(right)) ? 0 : ((*(long*)(left) < *(long*)(right)) ? -1 : 1);
+}
+
+void* tree_create (void)
+{
+    return rb_new (compare, NULL);
+}
+
+void* topdown_create (void)
+{
+    return rb_new_ex (compare, NULL, RB_TOPDOWN, NULL);
+}
+
+void tree_destroy (void* ctx)
+{
+    rb_delete (ctx);
+}
+
+int tree_insert (const long* key, void* ctx)
+{
+    return rb_insert ((void*)key, ctx) != NULL;
+}
+
+int tree_find (const long* key, void* ctx)
+{
+    return rb_find (key, ctx) != NULL;
+}
+
+void tree_remove (const long* key, void* ctx)
+{
+    rb_remove (key, ctx);
+}
+
+long tree_iterate (void* ctx)
+{
+    struct rbiter it;
+    unsigned long sum = 0;
+
+    for (long* key = it_beg (&it, ctx); key != NULL; key = it_next (&it))
+    {
+        sum += (unsigned long)*key;
+    }
+
+    return (long)sum;
+}
+
+const struct bench_ops tree_ops = {"rbtree", tree_create, tree_destroy, tree_insert, tree_find, tree_remove, tree_iterate};
+const struct bench_ops topdown_ops = {"rbtree-topdown", topdown_create, tree_destroy, tree_insert, tree_find, tree_remove, tree_iterate};
+
+/*
+ * usage: rbtree.bench [max size] [container]
+ * runs every workload from 1K keys up to max size (1M by default) for rbtree, rbtree with
+ * top-down rebalancing and std::map.
+ */
+int main (int argc, char** argv)
+{
+    size_t max_size = (argc > 1) ? strtoull (argv[1], NULL, 10) : 1000000;
+    const struct bench_ops* containers[] = {&tree_ops, &topdown_ops, &map_ops};
+
+    for (size_t i = 0; i < sizeof (containers) / sizeof (containers[0]); ++i)
+    {
+        if (argc > 2 && strcmp (argv[2], containers[i]->name) != 0)
+        {
+            continue;
+        }
+
+        bench_run (containers[i], max_size);
+    }
+
+    return 0;
+}
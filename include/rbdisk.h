@@ -0,0 +1,202 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2023 Mathieu Rabine
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _RBDISK_H_
+#define _RBDISK_H_
+
+// rbtree.
+#include <rbtree.h>
+
+// C.
+#include <stdint.h>
+
+/// file format version.
+#define RB_DISK_VERSION 1
+
+/// alignment of the file sections.
+#define RB_DISK_PAGE    4096
+
+/**
+ * @brief file header, stored in the first page.
+ */
+struct rbdiskheader
+{
+    char           magic[8];    // "RBTREE\r\n".
+    uint32_t       version;     // file format version.
+    uint32_t       order;       // 0x01020304 in the byte order of the writer.
+    uint64_t       count;       // number of elements.
+    uint64_t       index;       // offset of the record offsets.
+    uint64_t       index_size;  // size of the record offsets.
+    uint64_t       blob;        // offset of the records.
+    uint64_t       blob_size;   // size of the records.
+    uint32_t       index_crc;   // crc32 of the record offsets.
+    uint32_t       blob_crc;    // crc32 of the records.
+    uint32_t       header_crc;  // crc32 of the header up to this field.
+    uint32_t       reserved;    // zero.
+};
+
+/**
+ * @brief tree mapped from a file.
+ */
+struct rbdisk
+{
+    rb_compare*    comp;        // compare elements.
+    size_t         count;       // number of elements.
+    const uint64_t* index;      // offsets of the records in the blob, in element order.
+    const char*    blob;        // records.
+    const struct rbdiskheader* header;  // file header, start of the mapping.
+    size_t         size;        // size of the mapping.
+};
+
+/**
+ * @brief iterator over a mapped tree.
+ */
+struct rbdiskiter
+{
+    const struct rbdisk* disk;  // mapped tree.
+    size_t         index;       // current position, count past the ends.
+};
+
+/**
+ * @brief write a tree to a file.
+ * @param path file path.
+ * @param serialize element serialization function.
+ * @param tree tree context.
+ * @return 0 on success, -1 on failure.
+ * @note the file holds a header page, the record offsets in element order and the records,
+ * each section aligned on RB_DISK_PAGE. A record is its 64-bit length followed by the
+ * serialized element, padded to 8 bytes so that mapped elements stay aligned. The header is
+ * written last, an interrupted write leaves a file that fails to open.
+ */
+int rb_disk_write (const char* path, rb_serialize* serialize, struct rbtree* tree);
+
+/**
+ * @brief map a tree file for reading.
+ * @param path file path.
+ * @param compare function used to compare the serialized elements.
+ * @return mapped tree, NULL if the file can't be mapped or its header is invalid.
+ * @note only the header is checked, pages of the file are read on first access. Use
+ * rb_disk_verify before searching a file that may be corrupted.
+ */
+struct rbdisk* rb_disk_open (const char* path, rb_compare* compare);
+
+/**
+ * @brief unmap a tree file.
+ * @param disk mapped tree.
+ */
+void rb_disk_close (struct rbdisk* disk);
+
+/**
+ * @brief check the checksums and the record bounds of a mapped tree.
+ * @param disk mapped tree.
+ * @return 0 if the file is consistent, -1 otherwise.
+ * @note this reads the whole file.
+ */
+int rb_disk_verify (const struct rbdisk* disk);
+
+/**
+ * @brief finds element in the mapped tree.
+ * @param data element to find.
+ * @param disk mapped tree.
+ * @return serialized element found, inside the mapping.
+ */
+void* rb_disk_find (const void* data, const struct rbdisk* disk);
+
+/**
+ * @brief finds the first element not ordered before the given one.
+ * @param data element to compare to.
+ * @param disk mapped tree.
+ * @return first element greater or equal, NULL if none.
+ */
+void* rb_disk_lower_bound (const void* data, const struct rbdisk* disk);
+
+/**
+ * @brief finds the first element ordered after the given one.
+ * @param data element to compare to.
+ * @param disk mapped tree.
+ * @return first element greater, NULL if none.
+ */
+void* rb_disk_upper_bound (const void* data, const struct rbdisk* disk);
+
+/**
+ * @brief returns the number of elements in the mapped tree.
+ * @param disk mapped tree.
+ * @return the number of elements.
+ */
+size_t rb_disk_size (const struct rbdisk* disk);
+
+/**
+ * @brief returns the serialized size of a mapped element.
+ * @param data element returned by a lookup or an iterator.
+ * @return size of the element.
+ */
+size_t rb_disk_length (const void* data);
+
+/**
+ * @brief move iterator on first element of the mapped tree.
+ * @param it iterator.
+ * @param disk mapped tree.
+ * @return first element, NULL if empty.
+ */
+void* dk_beg  (struct rbdiskiter* it, const struct rbdisk* disk);
+
+/**
+ * @brief move iterator on last element of the mapped tree.
+ * @param it iterator.
+ * @param disk mapped tree.
+ * @return last element, NULL if empty.
+ */
+void* dk_end  (struct rbdiskiter* it, const struct rbdisk* disk);
+
+/**
+ * @brief move iterator on the first element not ordered before the given one.
+ * @param it iterator.
+ * @param disk mapped tree.
+ * @param data element to compare to.
+ * @return first element greater or equal, NULL if none.
+ */
+void* dk_seek (struct rbdiskiter* it, const struct rbdisk* disk, const void* data);
+
+/**
+ * @brief move iterator to the next element.
+ * @param it iterator.
+ * @return next element, NULL past the last one.
+ */
+void* dk_next (struct rbdiskiter* it);
+
+/**
+ * @brief move iterator to the previous element.
+ * @param it iterator.
+ * @return previous element, NULL past the first one.
+ */
+void* dk_prev (struct rbdiskiter* it);
+
+/**
+ * @brief get current element pointed by iterator.
+ * @param it iterator.
+ * @return current element.
+ */
+void* dk_cur  (struct rbdiskiter* it);
+
+#endif
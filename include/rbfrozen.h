@@ -0,0 +1,226 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2023 Mathieu Rabine
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _RBFROZEN_H_
+#define _RBFROZEN_H_
+
+// rbtree.
+#include <rbtree.h>
+
+/// integer key types of a snapshot index.
+#define RB_KEY_I32      1       // int32_t keys.
+#define RB_KEY_I64      2       // int64_t keys.
+#define RB_KEY_U64      3       // uint64_t keys.
+
+/// instruction sets of the index search.
+#define RB_SIMD_AUTO    0       // best one supported by the cpu.
+#define RB_SIMD_NONE    1       // scalar code.
+#define RB_SIMD_SSE     2       // sse4.2.
+#define RB_SIMD_AVX2    3       // avx2.
+
+/// index search function pointer, returns the slot of the lower bound or SIZE_MAX.
+typedef size_t rb_fzsearch (const void* keys, size_t nblocks, const void* key);
+
+/**
+ * @brief immutable snapshot of a tree.
+ */
+struct rbfrozen
+{
+    rb_compare*    comp;        // compare elements.
+    uint32_t       count;       // number of elements.
+    void**         items;       // elements in eytzinger order, from index 1.
+    int            key_type;    // type of the integer key index, 0 if none.
+    int            simd;        // instruction set of the index search.
+    size_t         nblocks;     // number of key blocks.
+    void*          keys;        // integer keys in blocks of a cache line, k-ary eytzinger order.
+    void**         slots;       // element of each key slot, NULL for padding.
+    rb_fzsearch*   search;      // index search function.
+};
+
+/**
+ * @brief iterator over a snapshot.
+ */
+struct rbfziter
+{
+    const struct rbfrozen* frozen;  // snapshot.
+    uint32_t       index;       // current eytzinger index, 0 past the ends.
+};
+
+/**
+ * @brief build an immutable snapshot of a tree.
+ * @param tree tree context.
+ * @return snapshot, NULL if out of memory or the tree holds more than 2^32 - 2 elements.
+ * @note elements are stored in one contiguous array in eytzinger (breadth-first) order, the
+ * children of index i are 2i and 2i + 1 so that no child pointer is stored at all, and the
+ * top levels shared by all lookups stay in cache. The snapshot references the elements of the
+ * tree without owning them, later changes to the tree are not reflected.
+ */
+struct rbfrozen* rb_freeze (struct rbtree* tree);
+
+/**
+ * @brief delete a snapshot, the elements are left untouched.
+ * @param frozen snapshot.
+ */
+void rb_frozen_delete (struct rbfrozen* frozen);
+
+/**
+ * @brief finds element in the snapshot.
+ * @param data element to find.
+ * @param frozen snapshot.
+ * @return element found.
+ */
+void* rb_frozen_find (const void* data, const struct rbfrozen* frozen);
+
+/**
+ * @brief finds the first element not ordered before the given one.
+ * @param data element to compare to.
+ * @param frozen snapshot.
+ * @return first element greater or equal, NULL if none.
+ */
+void* rb_frozen_lower_bound (const void* data, const struct rbfrozen* frozen);
+
+/**
+ * @brief finds the first element ordered after the given one.
+ * @param data element to compare to.
+ * @param frozen snapshot.
+ * @return first element greater, NULL if none.
+ */
+void* rb_frozen_upper_bound (const void* data, const struct rbfrozen* frozen);
+
+/**
+ * @brief returns the number of elements in the snapshot.
+ * @param frozen snapshot.
+ * @return the number of elements.
+ */
+size_t rb_frozen_size (const struct rbfrozen* frozen);
+
+/**
+ * @brief build an integer key index over the snapshot.
+ * @param type key type, RB_KEY_I32, RB_KEY_I64 or RB_KEY_U64.
+ * @param offset offset of the key in the elements.
+ * @param simd instruction set, RB_SIMD_AUTO for the best one supported.
+ * @param frozen snapshot.
+ * @return 0 on success, -1 on failure.
+ * @note the integer keys must sort like the comparison function. Keys are stored in blocks
+ * of one cache line, 16 int32 or 8 int64, and a block has one child per gap between its keys
+ * (k-ary eytzinger layout), so that each level costs one cache miss and two vector compares.
+ * The instruction set is checked at run time, unsupported ones fall back to the best lower one.
+ */
+int rb_frozen_index (int type, size_t offset, int simd, struct rbfrozen* frozen);
+
+/**
+ * @brief finds element by int32 key in the snapshot index.
+ * @param key key to find.
+ * @param frozen snapshot indexed with RB_KEY_I32.
+ * @return element found.
+ */
+void* rb_frozen_find_i32 (int32_t key, const struct rbfrozen* frozen);
+
+/**
+ * @brief finds element by int64 key in the snapshot index.
+ * @param key key to find.
+ * @param frozen snapshot indexed with RB_KEY_I64.
+ * @return element found.
+ */
+void* rb_frozen_find_i64 (int64_t key, const struct rbfrozen* frozen);
+
+/**
+ * @brief finds element by uint64 key in the snapshot index.
+ * @param key key to find.
+ * @param frozen snapshot indexed with RB_KEY_U64.
+ * @return element found.
+ */
+void* rb_frozen_find_u64 (uint64_t key, const struct rbfrozen* frozen);
+
+/**
+ * @brief finds the first element whose int32 key is not lower than the given one.
+ * @param key key to compare to.
+ * @param frozen snapshot indexed with RB_KEY_I32.
+ * @return first element greater or equal, NULL if none.
+ */
+void* rb_frozen_lower_bound_i32 (int32_t key, const struct rbfrozen* frozen);
+
+/**
+ * @brief finds the first element whose int64 key is not lower than the given one.
+ * @param key key to compare to.
+ * @param frozen snapshot indexed with RB_KEY_I64.
+ * @return first element greater or equal, NULL if none.
+ */
+void* rb_frozen_lower_bound_i64 (int64_t key, const struct rbfrozen* frozen);
+
+/**
+ * @brief finds the first element whose uint64 key is not lower than the given one.
+ * @param key key to compare to.
+ * @param frozen snapshot indexed with RB_KEY_U64.
+ * @return first element greater or equal, NULL if none.
+ */
+void* rb_frozen_lower_bound_u64 (uint64_t key, const struct rbfrozen* frozen);
+
+/**
+ * @brief move iterator on first element of the snapshot.
+ * @param it iterator.
+ * @param frozen snapshot.
+ * @return first element, NULL if empty.
+ */
+void* fz_beg  (struct rbfziter* it, const struct rbfrozen* frozen);
+
+/**
+ * @brief move iterator on last element of the snapshot.
+ * @param it iterator.
+ * @param frozen snapshot.
+ * @return last element, NULL if empty.
+ */
+void* fz_end  (struct rbfziter* it, const struct rbfrozen* frozen);
+
+/**
+ * @brief move iterator on the first element not ordered before the given one.
+ * @param it iterator.
+ * @param frozen snapshot.
+ * @param data element to compare to.
+ * @return first element greater or equal, NULL if none.
+ */
+void* fz_seek (struct rbfziter* it, const struct rbfrozen* frozen, const void* data);
+
+/**
+ * @brief move iterator to the next element of the snapshot.
+ * @param it iterator.
+ * @return next element.
+ */
+void* fz_next (struct rbfziter* it);
+
+/**
+ * @brief move iterator to the previous element of the snapshot.
+ * @param it iterator.
+ * @return previous element.
+ */
+void* fz_prev (struct rbfziter* it);
+
+/**
+ * @brief get current element pointed by iterator.
+ * @param it iterator.
+ * @return current element.
+ */
+void* fz_cur  (struct rbfziter* it);
+
+#endif
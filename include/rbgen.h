@@ -0,0 +1,129 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2023 Mathieu Rabine
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _RBGEN_H_
+#define _RBGEN_H_
+
+// rbtree.
+#include <rbtree.h>
+
+/// three-way comparison of scalar keys.
+#define RB_CMP(left, right) (((left) > (right)) - ((left) < (right)))
+
+/**
+ * @brief generate functions specialized for an intrusive tree of a concrete element type.
+ * @param name prefix of the generated functions.
+ * @param type element type.
+ * @param field name of the struct rbnode member embedded in the element.
+ * @param ktype key type.
+ * @param key name of the key member of the element.
+ * @param cmp three-way comparison of two keys, a function or a macro such as RB_CMP.
+ *
+ * the generated functions are:
+ * - int   name_compare (const void* left, const void* right): comparison function to pass to rb_new_ex
+ *   so that the generic API and iterators can be used on the same tree.
+ * - type* name_find    (ktype key, struct rbtree* tree): finds element, NULL if not found.
+ * - type* name_insert  (type* elm, struct rbtree* tree): inserts element, NULL if the key already exists.
+ * - type* name_remove  (ktype key, struct rbtree* tree): unlinks element and returns it, NULL if not found.
+ *
+ * keys are compared inline instead of through tree->comp, the tree must be created with RB_INTRUSIVE.
+ */
+#define RB_GENERATE(name, type, field, ktype, key, cmp)                                     \
+                                                                                            \
+static inline int name##_compare (const void* left, const void* right)                      \
+{                                                                                           \
+    return cmp (rb_entry (left, type, field)->key, rb_entry (right, type, field)->key);     \
+}                                                                                           \
+                                                                                            \
+static inline type* name##_find (ktype key, struct rbtree* tree)                            \
+{                                                                                           \
+    struct rbnode* node = tree->root;                                                       \
+                                                                                            \
+    while (node != NULL)                                                                    \
+    {                                                                                       \
+        type* elm = rb_entry (node, type, field);                                           \
+        int comp = cmp (elm->key, key);                                                     \
+        if (comp == 0)                                                                      \
+            return elm;                                                                     \
+        node = node->link[comp < 0];                                                        \
+    }                                                                                       \
+                                                                                            \
+    return NULL;                                                                            \
+}                                                                                           \
+                                                                                            \
+static inline type* name##_insert (type* elm, struct rbtree* tree)                          \
+{                                                                                           \
+    struct rbnode* parent = NULL;                                                           \
+    struct rbnode* node = tree->root;                                                       \
+    int dir = 0;                                                                            \
+                                                                                            \
+    while (node != NULL)                                                                    \
+    {                                                                                       \
+        int comp = cmp (rb_entry (node, type, field)->key, elm->key);                       \
+        if (comp == 0)                                                                      \
+            return NULL;                                                                    \
+        parent = node;                                                                      \
+        dir = comp < 0;                                                                     \
+        node = node->link[dir];                                                             \
+    }                                                                                       \
+                                                                                            \
+    rb_link (&elm->field, parent, dir, tree);                                               \
+                                                                                            \
+    return elm;                                                                             \
+}                                                                                           \
+                                                                                            \
+static inline type* name##_remove (ktype key, struct rbtree* tree)                          \
+{                                                                                           \
+    type* elm = name##_find (key, tree);                                                    \
+                                                                                            \
+    if (elm != NULL)                                                                        \
+    {                                                                                       \
+        rb_unlink (&elm->field, tree);                                                      \
+    }                                                                                       \
+                                                                                            \
+    return elm;                                                                             \
+}
+
+/**
+ * @brief tree element with an int key.
+ */
+struct rbint
+{
+    struct rbnode  node;        // node.
+    int            key;         // key.
+};
+
+/**
+ * @brief tree element with an uint64_t key.
+ */
+struct rbu64
+{
+    struct rbnode  node;        // node.
+    uint64_t       key;         // key.
+};
+
+RB_GENERATE (rb_int, struct rbint, node, int, key, RB_CMP)
+RB_GENERATE (rb_u64, struct rbu64, node, uint64_t, key, RB_CMP)
+
+#endif
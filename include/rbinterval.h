@@ -0,0 +1,73 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2023 Mathieu Rabine
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _RBINTERVAL_H_
+#define _RBINTERVAL_H_
+
+// rbtree.
+#include <rbtree.h>
+
+/**
+ * @brief interval [lo, hi] stored in an interval tree.
+ */
+struct rbinterval
+{
+    long           lo;          // lower bound.
+    long           hi;          // upper bound.
+    long           max;         // greatest upper bound of the subtree, maintained by the tree.
+};
+
+/**
+ * @brief create an interval tree.
+ * @param destroy delete function (optional).
+ * @return tree context.
+ * @note elements are struct rbinterval, ordered by lower bound, upper bound then address,
+ * so that equal intervals can be stored and removed by address with rb_remove.
+ */
+struct rbtree* rb_interval_new (rb_destroy* destroy);
+
+/**
+ * @brief visit intervals containing a point.
+ * @param point point to look for.
+ * @param visit function called on each interval, visiting stops when it returns non zero.
+ * @param ctx context passed to the visit function.
+ * @param tree interval tree context.
+ * @return number of intervals visited.
+ * @note subtrees whose greatest upper bound is below the point or whose lower bounds are above
+ * it are skipped.
+ */
+size_t rb_stab (long point, rb_visit* visit, void* ctx, struct rbtree* tree);
+
+/**
+ * @brief visit intervals overlapping [lo, hi].
+ * @param lo lower bound.
+ * @param hi upper bound.
+ * @param visit function called on each interval, visiting stops when it returns non zero.
+ * @param ctx context passed to the visit function.
+ * @param tree interval tree context.
+ * @return number of intervals visited.
+ */
+size_t rb_overlap (long lo, long hi, rb_visit* visit, void* ctx, struct rbtree* tree);
+
+#endif
@@ -53,6 +53,26 @@ void* it_beg  (struct rbiter* it, struct rbtree* tree);
  */
 void* it_end  (struct rbiter* it, struct rbtree* tree);
 
+/**
+ * @brief move iterator on the first element not ordered before the given one.
+ * @param it iterator.
+ * @param tree tree context.
+ * @param data element to compare to.
+ * @return first element greater or equal, NULL if none.
+ */
+void* it_seek (struct rbiter* it, struct rbtree* tree, const void* data);
+
+/**
+ * @brief move iterators around the elements equal to the given one.
+ * @param data element to compare to.
+ * @param first iterator moved on the first equal element.
+ * @param last iterator moved on the first greater element, past the end if none.
+ * @param tree tree context.
+ * @return first equal element, NULL if none.
+ * @note equal elements are walked with it_next from first until it reaches the node of last.
+ */
+void* rb_equal_range (const void* data, struct rbiter* first, struct rbiter* last, struct rbtree* tree);
+
 /**
  * @brief move iterator to the next element of the tree.
  * @param it iterator.
@@ -67,6 +87,26 @@ void* it_next (struct rbiter* it);
  */
 void* it_prev (struct rbiter* it);
 
+/**
+ * @brief remove the current element and move iterator to the next one.
+ * @param it iterator.
+ * @return next element of the tree, NULL if none.
+ * @note the element is removed with rb_erase, without a lookup.
+ */
+void* it_erase (struct rbiter* it);
+
+/**
+ * @brief insert element next to the one pointed by iterator and move iterator on it.
+ * @param data element to insert.
+ * @param hint iterator on the element following the new one, or preceding it, past the end to append.
+ * @param tree tree context.
+ * @return element inserted, NULL if an equal element is present and the tree is not RB_MULTI.
+ * @note a right hint costs two comparisons and amortized O(1) rebalancing, so keys inserted in
+ * order with the iterator left on the last one are appended without any descent. A wrong hint
+ * falls back to a descent from the root.
+ */
+void* rb_insert_hint (void* data, struct rbiter* hint, struct rbtree* tree);
+
 /**
  * @brief get current element of the tree pointed by iterator.
  * @param it iterator.
@@ -0,0 +1,151 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2023 Mathieu Rabine
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _RBPART_H_
+#define _RBPART_H_
+
+// rbtree.
+#include <rbiter.h>
+
+// C.
+#include <pthread.h>
+
+/**
+ * @brief splitter function, maps an element to the index of its partition.
+ * @param data element.
+ * @param nparts number of partitions.
+ * @param ctx user context.
+ * @return partition index, in [0, nparts).
+ * @note elements mapped outside [0, nparts) are refused: insert and find return NULL, remove
+ * does nothing.
+ * @note a hash spreads writers evenly, a key-range splitter keeps partitions ordered
+ * relative to each other, global ordered iteration works with both.
+ */
+typedef size_t rb_splitter (const void* data, size_t nparts, void* ctx);
+
+/**
+ * @brief partition of a partitioned tree, alone on its cache line.
+ */
+struct rbpartition
+{
+    struct rbtree*   tree;      // tree of the partition.
+    pthread_mutex_t  lock;      // lock of the partition.
+} __attribute__ ((aligned (64)));
+
+/**
+ * @brief partitioned tree.
+ */
+struct rbpart
+{
+    struct rbpartition* parts;  // partitions.
+    size_t           nparts;    // number of partitions.
+    rb_splitter*     split;     // splitter function.
+    void*            ctx;       // splitter function context.
+};
+
+/**
+ * @brief ordered iterator over all partitions.
+ */
+struct rbpartiter
+{
+    struct rbpart*   part;      // partitioned tree.
+    struct rbiter*   its;       // one iterator per partition.
+    size_t*          heap;      // partitions ordered by current element.
+    size_t           size;      // number of partitions in the heap.
+};
+
+/**
+ * @brief create a partitioned tree.
+ * @param compare comparison function.
+ * @param destroy delete function (optional).
+ * @param nparts number of partitions.
+ * @param split splitter function.
+ * @param ctx splitter function context.
+ * @return tree context.
+ * @note each partition is an independent tree with its own lock, so writers to different
+ * partitions run in parallel.
+ */
+struct rbpart* rb_part_new (rb_compare* compare, rb_destroy* destroy, size_t nparts, rb_splitter* split, void* ctx);
+
+/**
+ * @brief delete partitioned tree.
+ * @param part tree context.
+ */
+void rb_part_delete (struct rbpart* part);
+
+/**
+ * @brief inserts elements in the tree.
+ * @param data element to insert.
+ * @param part tree context.
+ * @return element inserted, NULL if an equal element is present or the splitter is out of range.
+ */
+void* rb_part_insert (void* data, struct rbpart* part);
+
+/**
+ * @brief finds element in the tree.
+ * @param data element to find.
+ * @param part tree context.
+ * @return element found.
+ */
+void* rb_part_find (const void* data, struct rbpart* part);
+
+/**
+ * @brief remove element from the tree.
+ * @param data element to remove.
+ * @param part tree context.
+ */
+void rb_part_remove (const void* data, struct rbpart* part);
+
+/**
+ * @brief returns the number of elements in all partitions.
+ * @param part tree context.
+ * @return the number of elements in the tree.
+ * @note partitions are read one by one, the result is approximate under concurrent writers.
+ */
+size_t rb_part_size (struct rbpart* part);
+
+/**
+ * @brief move iterator on the smallest element of all partitions.
+ * @param it iterator.
+ * @param part tree context.
+ * @return first element, NULL if empty or out of memory.
+ * @note partitions are merged through a heap of per-partition iterators, the iterator holds
+ * every partition lock until it reaches the end or is released.
+ */
+void* rb_part_beg (struct rbpartiter* it, struct rbpart* part);
+
+/**
+ * @brief move iterator to the next element in order.
+ * @param it iterator.
+ * @return next element, NULL at the end.
+ */
+void* rb_part_next (struct rbpartiter* it);
+
+/**
+ * @brief release the locks and memory held by an iterator before its end.
+ * @param it iterator.
+ */
+void rb_part_release (struct rbpartiter* it);
+
+#endif
@@ -0,0 +1,137 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2023 Mathieu Rabine
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _RBRCU_H_
+#define _RBRCU_H_
+
+// rbtree.
+#include <rbtree.h>
+
+// C.
+#include <pthread.h>
+
+/**
+ * @brief reader of a concurrent tree.
+ */
+struct rbreader
+{
+    unsigned long    epoch;     // epoch at read lock, 0 outside of read sections.
+    struct rbreader* next;      // next registered reader.
+    struct rbrcu*    tree;      // tree context.
+} __attribute__ ((aligned (64)));
+
+/**
+ * @brief concurrent read-mostly tree.
+ */
+struct rbrcu
+{
+    struct rbtree*   copy[2];   // latched copies of the tree.
+    unsigned long    seq;       // latch sequence, readers use copy[seq & 1].
+    unsigned long    epoch;     // grace period epoch.
+    rb_destroy*      del;       // delete nodes data.
+    struct rbreader* readers;   // registered readers.
+    void**           retired;   // nodes and data waiting for the end of the grace period.
+    size_t           nretired;  // number of retired pointers.
+    size_t           cap;       // capacity of the retired array.
+    pthread_mutex_t  lock;      // serialize writers.
+};
+
+/**
+ * @brief create a concurrent tree.
+ * @param compare comparison function.
+ * @param destroy delete function (optional).
+ * @return tree context.
+ * @note readers never lock nor use atomic read-modify-write instructions: the tree is kept in two
+ * latched copies, writers update one copy while readers use the other, and freed nodes and data
+ * are reclaimed once all readers that could see them have left their read section.
+ */
+struct rbrcu* rb_rcu_new (rb_compare* compare, rb_destroy* destroy);
+
+/**
+ * @brief delete concurrent tree.
+ * @param tree tree context.
+ * @note no reader must be registered anymore.
+ */
+void rb_rcu_delete (struct rbrcu* tree);
+
+/**
+ * @brief register the calling thread as a reader.
+ * @param tree tree context.
+ * @return reader context, NULL on failure.
+ */
+struct rbreader* rb_rcu_register (struct rbrcu* tree);
+
+/**
+ * @brief unregister a reader.
+ * @param reader reader context.
+ */
+void rb_rcu_unregister (struct rbreader* reader);
+
+/**
+ * @brief enter a read section.
+ * @param reader reader context.
+ * @note elements found stay valid until rb_rcu_read_unlock, read sections do not nest.
+ */
+void rb_rcu_read_lock (struct rbreader* reader);
+
+/**
+ * @brief leave a read section.
+ * @param reader reader context.
+ */
+void rb_rcu_read_unlock (struct rbreader* reader);
+
+/**
+ * @brief finds element in the tree from a read section.
+ * @param data element to find.
+ * @param reader reader context.
+ * @return element found.
+ */
+void* rb_rcu_find (const void* data, struct rbreader* reader);
+
+/**
+ * @brief inserts elements in the tree.
+ * @param data element to insert.
+ * @param tree tree context.
+ * @return element inserted.
+ * @note writers are serialized and must not be called from a read section.
+ */
+void* rb_rcu_insert (void* data, struct rbrcu* tree);
+
+/**
+ * @brief remove element from the tree.
+ * @param data element to remove.
+ * @param tree tree context.
+ * @note waits for readers that may still see the element before deleting it,
+ * must not be called from a read section.
+ */
+void rb_rcu_remove (const void* data, struct rbrcu* tree);
+
+/**
+ * @brief returns the number of elements in the tree.
+ * @param tree tree context.
+ * @return the number of elements in the tree.
+ */
+size_t rb_rcu_size (struct rbrcu* tree);
+
+#endif
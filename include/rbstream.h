@@ -0,0 +1,69 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2023 Mathieu Rabine
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _RBSTREAM_H_
+#define _RBSTREAM_H_
+
+// rbtree.
+#include <rbtree.h>
+
+/// stream format version.
+#define RB_STREAM_VERSION 1
+
+/// output function pointer, writes all bytes and returns 0 on success, -1 on failure.
+typedef int rb_writer (const void* data, size_t size, void* ctx);
+
+/// input function pointer, returns the number of bytes read, 0 at the end of the stream or on failure.
+typedef size_t rb_reader (void* data, size_t size, void* ctx);
+
+/// element deserialization function pointer, returns a new element or NULL on failure.
+typedef void* rb_deserialize (const void* buffer, size_t size);
+
+/**
+ * @brief write a tree to a stream.
+ * @param write output function.
+ * @param ctx output context.
+ * @param serialize element serialization function.
+ * @param tree tree context.
+ * @return 0 on success, -1 on failure.
+ * @note the stream starts with a header holding the element count, followed by each element in
+ * order as a 64-bit length and the serialized element. Elements are serialized in place in a
+ * buffer handed to the output function once full.
+ */
+int rb_stream_write (rb_writer* write, void* ctx, rb_serialize* serialize, struct rbtree* tree);
+
+/**
+ * @brief read a tree from a stream.
+ * @param read input function.
+ * @param ctx input context.
+ * @param deserialize element deserialization function.
+ * @param tree tree context, must be empty.
+ * @return 0 on success, -1 on failure.
+ * @note the tree is built with rb_build_source as records arrive, without inserting or gathering
+ * elements, so loading only needs the nodes, one buffer and O(log n) stack. On failure the
+ * elements already read are released with the destroy function and the tree stays empty.
+ */
+int rb_stream_read (rb_reader* read, void* ctx, rb_deserialize* deserialize, struct rbtree* tree);
+
+#endif
@@ -0,0 +1,173 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2023 Mathieu Rabine
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _RBSYNC_H_
+#define _RBSYNC_H_
+
+// rbtree.
+#include <rbiter.h>
+
+// C.
+#include <pthread.h>
+
+/// number of reader counters.
+#define RB_SYNC_SHARDS 16
+
+/// number of trees a thread can read lock at once.
+#define RB_SYNC_NESTED 8
+
+/**
+ * @brief reader counter, alone on its cache line.
+ */
+struct rbshard
+{
+    unsigned long    readers;   // number of readers holding the lock.
+} __attribute__ ((aligned (64)));
+
+/**
+ * @brief thread-safe tree.
+ */
+struct rbsync
+{
+    struct rbshard   shards[RB_SYNC_SHARDS]; // reader counters.
+    struct rbtree*   tree;      // tree.
+    int              writer;    // a writer holds or waits for the lock.
+    pthread_mutex_t  lock;      // serialize writers.
+};
+
+/**
+ * @brief iterator of a thread-safe tree.
+ */
+struct rbsynciter
+{
+    struct rbiter    it;        // tree iterator.
+    struct rbsync*   sync;      // thread-safe tree.
+    int              held;      // the iterator holds a read lock.
+};
+
+/**
+ * @brief create a thread-safe tree.
+ * @param compare comparison function.
+ * @param destroy delete function (optional).
+ * @return tree context.
+ * @note readers increment a counter picked by thread among RB_SYNC_SHARDS counters, each on its
+ * own cache line, so that concurrent readers do not contend on a single line.
+ */
+struct rbsync* rb_sync_new (rb_compare* compare, rb_destroy* destroy);
+
+/**
+ * @brief delete thread-safe tree.
+ * @param sync tree context.
+ */
+void rb_sync_delete (struct rbsync* sync);
+
+/**
+ * @brief acquire the lock for reading.
+ * @param sync tree context.
+ * @return 0 on success, -1 if the thread already read locks RB_SYNC_NESTED other trees.
+ * @note read locks are re-entrant: a thread already holding one, for instance through an open
+ * iterator, takes it again without waiting for a queued writer, which would deadlock. Threads
+ * track the trees they read lock, so a read lock belongs to the thread that took it.
+ */
+int rb_sync_read_lock (struct rbsync* sync);
+
+/**
+ * @brief release the lock acquired for reading.
+ * @param sync tree context.
+ * @return 0 on success, -1 if the calling thread does not hold the lock, which is then left as is.
+ * @note the lock must be released by the thread that took it.
+ */
+int rb_sync_read_unlock (struct rbsync* sync);
+
+/**
+ * @brief acquire the lock for writing.
+ * @param sync tree context.
+ */
+void rb_sync_write_lock (struct rbsync* sync);
+
+/**
+ * @brief release the lock acquired for writing.
+ * @param sync tree context.
+ */
+void rb_sync_write_unlock (struct rbsync* sync);
+
+/**
+ * @brief inserts elements in the tree.
+ * @param data element to insert.
+ * @param sync tree context.
+ * @return element inserted.
+ */
+void* rb_sync_insert (void* data, struct rbsync* sync);
+
+/**
+ * @brief finds element in the tree.
+ * @param data element to find.
+ * @param sync tree context.
+ * @return element found, NULL if none or if the read lock could not be taken.
+ * @note the element may be removed as soon as the call returns, hold the read lock
+ * around rb_find on sync->tree to keep using it.
+ */
+void* rb_sync_find (const void* data, struct rbsync* sync);
+
+/**
+ * @brief remove element from the tree.
+ * @param data element to remove.
+ * @param sync tree context.
+ */
+void rb_sync_remove (const void* data, struct rbsync* sync);
+
+/**
+ * @brief returns the number of elements in the tree.
+ * @param sync tree context.
+ * @return the number of elements in the tree.
+ */
+size_t rb_sync_size (struct rbsync* sync);
+
+/**
+ * @brief move iterator on first element of the tree.
+ * @param it iterator.
+ * @param sync tree context.
+ * @return first element of the tree, NULL if empty or if the read lock could not be taken.
+ * @note the iterator holds a read lock until it reaches the end or is released, writers wait
+ * meanwhile so that it never walks freed nodes, the holding thread must not write to the tree.
+ * @note the read lock belongs to the calling thread, the iterator must be walked to its end or
+ * released by that thread.
+ */
+void* rb_sync_beg (struct rbsynciter* it, struct rbsync* sync);
+
+/**
+ * @brief move iterator to the next element of the tree.
+ * @param it iterator.
+ * @return next element of the tree, NULL at the end.
+ */
+void* rb_sync_next (struct rbsynciter* it);
+
+/**
+ * @brief release the read lock held by an iterator before its end.
+ * @param it iterator.
+ * @note only the thread that opened the iterator can release it, other threads leave it held.
+ */
+void rb_sync_release (struct rbsynciter* it);
+
+#endif
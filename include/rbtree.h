@@ -28,6 +28,7 @@
 // C.
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 
 /// comparison function pointer.
 typedef int rb_compare (const void* left, const void* right);
@@ -35,17 +36,143 @@ typedef int rb_compare (const void* left, const void* right);
 /// destroy function pointer.
 typedef void rb_destroy (void* data);
 
+/// visit function pointer, returns non zero to stop visiting.
+typedef int rb_visit (void* data, void* ctx);
+
+/// node allocation function pointer.
+typedef void* rb_alloc (size_t size, void* ctx);
+
+/// node deallocation function pointer.
+typedef void rb_free (void* ptr, void* ctx);
+
+/// allocator release function pointer.
+typedef void rb_release (void* ctx);
+
+/// element source function pointer, returns the next element or NULL on failure.
+typedef void* rb_source (void* ctx);
+
+/// element serialization function pointer, returns the serialized size and only writes the element when it fits.
+typedef size_t rb_serialize (const void* data, void* buffer, size_t size);
+
+/**
+ * @brief node allocator.
+ */
+struct rballoc
+{
+    rb_alloc*      alloc;       // allocate a node.
+    rb_free*       free;        // free a node.
+    rb_release*    release;     // release all nodes at once (optional).
+    void*          ctx;         // allocator context.
+};
+
+/// tree flags.
+#define RB_INTRUSIVE    0x01    // nodes are embedded in the elements.
+#define RB_RANK         0x02    // nodes keep the size of their subtree.
+#define RB_MAP          0x04    // nodes hold a value next to the element, used as key.
+#define RB_MULTI        0x08    // equal elements are kept, in insertion order.
+#define RB_TOPDOWN      0x10    // insertions and removals rebalance on the way down.
+
+/// get the structure embedding a node.
+#define rb_entry(ptr, type, member) ((type*)((char*)(ptr) - offsetof (type, member)))
+
 /**
  * @brief tree node.
  */
 struct rbnode
 {
     struct rbnode* link[2];     // subtrees.
-    struct rbnode* parent;      // parent.
+    uintptr_t      parent_color;// parent, color in the low bit: red 1, black 0.
+};
+
+/**
+ * @brief get the parent of a node.
+ * @param node tree node.
+ * @return parent node, NULL for the root.
+ */
+static inline struct rbnode* rb_parent (const struct rbnode* node)
+{
+    return (struct rbnode*)(node->parent_color & ~(uintptr_t)1);
+}
+
+/**
+ * @brief get the color of a node.
+ * @param node tree node.
+ * @return 1 if red, 0 if black.
+ */
+static inline int rb_red (const struct rbnode* node)
+{
+    return (int)(node->parent_color & 1);
+}
+
+/**
+ * @brief set the parent of a node, keeping its color.
+ * @param node tree node.
+ * @param parent parent node.
+ */
+static inline void rb_set_parent (struct rbnode* node, struct rbnode* parent)
+{
+    node->parent_color = (uintptr_t)parent | (node->parent_color & 1);
+}
+
+/**
+ * @brief set the color of a node, keeping its parent.
+ * @param node tree node.
+ * @param red 1 for red, 0 for black.
+ */
+static inline void rb_set_red (struct rbnode* node, int red)
+{
+    node->parent_color = (node->parent_color & ~(uintptr_t)1) | (red != 0);
+}
+
+/**
+ * @brief tree node allocated by the tree.
+ */
+struct rbelem
+{
+    struct rbnode  node;        // node.
     void*          data;        // data.
-    int            red;         // color: red 1, black 0.
 };
 
+/**
+ * @brief operation counters.
+ */
+struct rbstats
+{
+    size_t         compares;    // comparisons of lookups, insertions and removals.
+    size_t         rotations;   // single rotations, a double rotation counts two.
+    size_t         recolors;    // color flips done while rebalancing.
+    size_t         allocs;      // nodes allocated.
+    size_t         frees;       // nodes freed.
+    size_t         descents;    // descents from the root.
+    size_t         depth_max;   // deepest descent.
+    size_t         depth_sum;   // total depth of all descents, divided by descents gives the average.
+    size_t         steps;       // iterator steps.
+};
+
+#ifdef RB_STATS
+#define rb_stat(tree, field, n) ((tree)->stats.field += (n))
+#define rb_stat_depth(tree, depth)                                                              \
+    do                                                                                          \
+    {                                                                                           \
+        ++(tree)->stats.descents;                                                               \
+        (tree)->stats.depth_sum += (depth);                                                     \
+        if ((depth) > (tree)->stats.depth_max)                                                  \
+            (tree)->stats.depth_max = (depth);                                                  \
+    }                                                                                           \
+    while (0)
+#else
+#define rb_stat(tree, field, n) ((void)0)
+#define rb_stat_depth(tree, depth) ((void)(depth))
+#endif
+
+/// compare two elements of a tree, counted in statistics.
+#define rb_comp(tree, left, right) (rb_stat (tree, compares, 1), (tree)->comp ((left), (right)))
+
+struct rbtree;
+
+/// augmentation function pointer, recomputes the node aggregate from its element and subtrees.
+typedef void rb_propagate (struct rbnode* node, struct rbtree* tree);
+
 /**
  * @brief tree.
  */
@@ -53,10 +180,29 @@ struct rbtree
 {
     rb_compare*    comp;        // compare nodes.
     rb_destroy*    del;         // delete nodes data.
+    rb_destroy*    vdel;        // delete nodes value (map trees).
     struct rbnode* root;        // root node.
+    struct rbnode* ends[2];     // first and last nodes.
     size_t         count;       // number of nodes.
+    struct rballoc alloc;       // node allocator.
+    int            flags;       // tree flags.
+    rb_propagate*  augment;     // augment nodes (optional).
+#ifdef RB_STATS
+    struct rbstats stats;       // operation counters.
+#endif
 };
 
+/**
+ * @brief get the element stored in a node.
+ * @param node tree node.
+ * @param tree tree context.
+ * @return the node itself for intrusive trees, the data held by the node otherwise.
+ */
+static inline void* rb_data (struct rbnode* node, const struct rbtree* tree)
+{
+    return (tree->flags & RB_INTRUSIVE) ? (void*)node : ((struct rbelem*)node)->data;
+}
+
 /**
  * @brief create the tree context.
  * @param compare comparison function.
@@ -65,6 +211,59 @@ struct rbtree
  */
 struct rbtree* rb_new (rb_compare* compare, rb_destroy* destroy);
 
+/**
+ * @brief create the tree context using flags and a custom node allocator.
+ * @param compare comparison function.
+ * @param destroy delete function (optional).
+ * @param flags tree flags (0 or a combination of RB_INTRUSIVE, RB_RANK, RB_MAP, RB_MULTI and RB_TOPDOWN).
+ * @param alloc node allocator (optional, malloc/free are used if NULL).
+ * @return tree context.
+ * @note if the allocator provides a release function, the tree takes ownership of its context
+ * and rb_delete releases all nodes at once instead of freeing them one by one.
+ * @note intrusive trees never allocate nodes: elements are the struct rbnode embedded in the
+ * caller records, compare and destroy receive these nodes and rb_entry gets the records back.
+ * @note RB_RANK trees allocate larger nodes to keep subtree sizes, so that rb_select and rb_rank
+ * run in O(log n), it is not available for intrusive trees.
+ * @note RB_MAP trees store a value in each node next to the element, which then acts as the key,
+ * see rb_put. It is not available for intrusive trees.
+ * @note RB_MULTI trees keep equal elements after the ones already present, lookups and removals
+ * by element reach the first of them, see rb_equal_range and it_erase to reach the others. Set
+ * operations are not available.
+ * @note insertions and removals descend without modifying the tree then fix colors up from the
+ * changed leaf, with at most three rotations. RB_TOPDOWN trees use the single-pass algorithm
+ * instead, which recolors and rotates on the way down whether needed or not.
+ */
+struct rbtree* rb_new_ex (rb_compare* compare, rb_destroy* destroy, int flags, const struct rballoc* alloc);
+
+/**
+ * @brief set the augmentation function of the tree.
+ * @param propagate augmentation function (NULL to disable).
+ * @param tree tree context, must be empty.
+ * @return 0 on success, -1 on failure.
+ * @note propagate is called on both nodes of every rotation, bottom-up along the path touched
+ * by insertions and removals and on every node of a bulk build, so that aggregates of a node
+ * only depend on its element and the aggregates of its subtrees (interval maximum, sums, ...).
+ */
+int rb_set_augment (rb_propagate* propagate, struct rbtree* tree);
+
+/**
+ * @brief set the function deleting the values of a map tree.
+ * @param destroy delete function (NULL to disable).
+ * @param tree tree context created with RB_MAP.
+ * @return 0 on success, -1 on failure.
+ * @note values are deleted when their node is removed or the tree is deleted, and when rb_put
+ * replaces them.
+ */
+int rb_set_value_destroy (rb_destroy* destroy, struct rbtree* tree);
+
+/**
+ * @brief get the value slot of a map node.
+ * @param node tree node, for instance the one of an iterator.
+ * @param tree tree context created with RB_MAP.
+ * @return value slot.
+ */
+void** rb_value (struct rbnode* node, struct rbtree* tree);
+
 /**
  * @brief delete tree.
  * @param tree tree context.
@@ -76,10 +275,46 @@ void rb_delete (struct rbtree* tree);
  * @brief inserts elements in the tree.
  * @param data element to insert.
  * @param tree tree context.
- * @return element inserted.
+ * @return element inserted, NULL if an equal element is present and the tree is not RB_MULTI.
  */
 void* rb_insert (void* data, struct rbtree* tree);
 
+/**
+ * @brief build the tree from elements sorted in ascending order.
+ * @param items elements to insert.
+ * @param n number of elements.
+ * @param tree tree context, must be empty.
+ * @return number of elements inserted, 0 on failure.
+ * @note the tree is built bottom-up in linear time, equal neighbours are rejected like rb_insert
+ * does and moved after the returned count, it fails if items are not sorted.
+ */
+size_t rb_build_sorted (void** items, size_t n, struct rbtree* tree);
+
+/**
+ * @brief build the tree from elements in any order.
+ * @param items elements to insert, sorted in place.
+ * @param n number of elements.
+ * @param tree tree context, must be empty.
+ * @return number of elements inserted, 0 on failure.
+ * @note items are sorted with a stable merge sort before the tree is built with rb_build_sorted,
+ * the first of equal elements is inserted.
+ */
+size_t rb_build (void** items, size_t n, struct rbtree* tree);
+
+/**
+ * @brief build the tree from elements produced in ascending order.
+ * @param next element source, called exactly n times unless it fails.
+ * @param ctx source context.
+ * @param n number of elements.
+ * @param tree tree context, must be empty.
+ * @return number of elements inserted, 0 on failure.
+ * @note the tree is built in order in linear time and only holds O(log n) pending subtrees, so
+ * elements never need to be gathered first. Elements are owned by the tree once produced, on
+ * failure the ones already produced are released with the destroy function and the tree stays empty.
+ * It fails if the source returns NULL or elements are not ascending (strictly unless RB_MULTI).
+ */
+size_t rb_build_source (rb_source* next, void* ctx, size_t n, struct rbtree* tree);
+
 /**
  * @brief finds element in the tree.
  * @param data element to find.
@@ -88,6 +323,64 @@ void* rb_insert (void* data, struct rbtree* tree);
  */
 void* rb_find (const void* data, struct rbtree* tree);
 
+/**
+ * @brief finds the first element not ordered before the given one.
+ * @param data element to compare to.
+ * @param tree tree context.
+ * @return first element greater or equal, NULL if none.
+ */
+void* rb_lower_bound (const void* data, struct rbtree* tree);
+
+/**
+ * @brief finds the first element ordered after the given one.
+ * @param data element to compare to.
+ * @param tree tree context.
+ * @return first element greater, NULL if none.
+ */
+void* rb_upper_bound (const void* data, struct rbtree* tree);
+
+/**
+ * @brief visit elements in the range [lo, hi) in ascending order.
+ * @param lo lower bound included (optional, from the first element if NULL).
+ * @param hi upper bound excluded (optional, up to the last element if NULL).
+ * @param visit function called on each element, visiting stops when it returns non zero.
+ * @param ctx context passed to the visit function.
+ * @param tree tree context.
+ * @return number of elements visited.
+ */
+size_t rb_range (const void* lo, const void* hi, rb_visit* visit, void* ctx, struct rbtree* tree);
+
+/**
+ * @brief finds several elements in the tree.
+ * @param keys elements to find.
+ * @param found elements found, NULL for missing keys.
+ * @param n number of elements.
+ * @param tree tree context.
+ * @return number of elements found.
+ * @note descents are interleaved by groups and prefetch the next level so that cache misses of
+ * several keys are in flight at once, results are the same as calling rb_find for each key.
+ */
+size_t rb_find_batch (const void** keys, void** found, size_t n, struct rbtree* tree);
+
+/**
+ * @brief inserts several elements in the tree.
+ * @param items elements to insert.
+ * @param inserted elements inserted, NULL for rejected elements (optional).
+ * @param n number of elements.
+ * @param tree tree context.
+ * @return number of elements inserted.
+ */
+size_t rb_insert_batch (void** items, void** inserted, size_t n, struct rbtree* tree);
+
+/**
+ * @brief remove several elements from the tree.
+ * @param keys elements to remove.
+ * @param n number of elements.
+ * @param tree tree context.
+ * @return number of elements removed.
+ */
+size_t rb_remove_batch (const void** keys, size_t n, struct rbtree* tree);
+
 /**
  * @brief remove element from the tree.
  * @param data element to remove.
@@ -96,6 +389,216 @@ void* rb_find (const void* data, struct rbtree* tree);
  */
 void rb_remove (const void* data, struct rbtree* tree);
 
+/**
+ * @brief inserts a key with its value, or assigns the value if the key is already present.
+ * @param key key to insert.
+ * @param value value to store.
+ * @param tree tree context created with RB_MAP.
+ * @return key stored in the tree, the given one if inserted, NULL if out of memory.
+ * @note a single descent does both the lookup and the insertion. When the key is already present
+ * it is kept and the given one stays owned by the caller, the replaced value is deleted with the
+ * value delete function.
+ */
+void* rb_put (void* key, void* value, struct rbtree* tree);
+
+/**
+ * @brief finds the value of a key.
+ * @param key key to find.
+ * @param tree tree context created with RB_MAP.
+ * @return value found, NULL if none.
+ */
+void* rb_get (const void* key, struct rbtree* tree);
+
+/**
+ * @brief finds the value slot of a key, inserting the key if it is missing.
+ * @param key key to find or insert.
+ * @param inserted set to 1 if the key was inserted, 0 otherwise (optional).
+ * @param tree tree context created with RB_MAP.
+ * @return value slot, NULL if out of memory.
+ * @note the slot of an inserted key holds NULL and is meant to be filled in by the caller, it
+ * stays valid until the key is removed.
+ */
+void** rb_get_or_insert (void* key, int* inserted, struct rbtree* tree);
+
+/**
+ * @brief removes a key and hands back its key and value.
+ * @param key key to remove.
+ * @param value receives the value of the removed key (optional).
+ * @param tree tree context created with RB_MAP.
+ * @return key removed, NULL if none.
+ * @note neither the key nor the value are deleted, they are owned by the caller again.
+ */
+void* rb_take (const void* key, void** value, struct rbtree* tree);
+
+/**
+ * @brief link a node in the tree and rebalance it.
+ * @param node node to link.
+ * @param parent parent node, NULL if the tree is empty.
+ * @param dir side of the parent where the node is linked: left 0, right 1.
+ * @param tree tree context.
+ * @note this is the bottom-up primitive used once the caller has located the insertion point,
+ * the node is not allocated and is expected to be embedded in an element of an intrusive tree.
+ */
+void rb_link (struct rbnode* node, struct rbnode* parent, int dir, struct rbtree* tree);
+
+/**
+ * @brief make a node for an element, link it in the tree and rebalance it.
+ * @param data element to link.
+ * @param parent parent node, NULL if the tree is empty.
+ * @param dir side of the parent where the node is linked: left 0, right 1.
+ * @param tree tree context.
+ * @return node linked, NULL if out of memory.
+ * @note same as rb_link for trees whose nodes are allocated, the caller is trusted on ordering.
+ */
+struct rbnode* rb_link_data (void* data, struct rbnode* parent, int dir, struct rbtree* tree);
+
+/**
+ * @brief unlink a node from the tree and rebalance it.
+ * @param node node to unlink.
+ * @param tree tree context.
+ * @note the node is neither freed nor destroyed.
+ */
+void rb_unlink (struct rbnode* node, struct rbtree* tree);
+
+/**
+ * @brief removes a node of the tree.
+ * @param node node to remove, for instance the one of an iterator.
+ * @param tree tree context.
+ * @note unlike rb_remove there is no lookup, so it reaches any of equal elements. The node is
+ * freed and its element deleted like rb_remove does.
+ */
+void rb_erase (struct rbnode* node, struct rbtree* tree);
+
+/**
+ * @brief get the first element of the tree.
+ * @param tree tree context.
+ * @return first element, NULL if empty.
+ * @note the first and last nodes are cached, this is O(1).
+ */
+void* rb_first (struct rbtree* tree);
+
+/**
+ * @brief get the last element of the tree.
+ * @param tree tree context.
+ * @return last element, NULL if empty.
+ */
+void* rb_last (struct rbtree* tree);
+
+/**
+ * @brief removes the first element of the tree.
+ * @param tree tree context.
+ * @return element removed, NULL if empty.
+ * @note the node is unlinked without any comparison and freed, the element is handed back
+ * without being deleted. The value of a map node can be read beforehand with rb_value on ends[0].
+ */
+void* rb_pop_first (struct rbtree* tree);
+
+/**
+ * @brief removes the last element of the tree.
+ * @param tree tree context.
+ * @return element removed, NULL if empty.
+ * @note see rb_pop_first.
+ */
+void* rb_pop_last (struct rbtree* tree);
+
+/**
+ * @brief appends all elements of another tree to the tree.
+ * @param right tree whose elements are all greater than the ones of tree, left empty.
+ * @param tree tree context.
+ * @return 0 on success, -1 if the trees are not compatible or their ranges overlap.
+ * @note both trees must share comparison function, flags, augmentation and allocator, pooled
+ * allocators are rejected since nodes move from one tree to the other. O(log n).
+ */
+int rb_join (struct rbtree* right, struct rbtree* tree);
+
+/**
+ * @brief moves the elements greater than data to another tree.
+ * @param data element to compare to.
+ * @param right empty tree receiving the greater elements.
+ * @param tree tree context, keeps the elements lower or equal to data, all of the equal ones
+ * for RB_MULTI trees.
+ * @return 0 on success, -1 if the trees are not compatible or right is not empty.
+ * @note O(log n) for RB_RANK trees, other trees count the moved elements in O(m).
+ */
+int rb_split (const void* data, struct rbtree* right, struct rbtree* tree);
+
+/**
+ * @brief merges all elements of another tree in the tree.
+ * @param other tree consumed by the operation, left empty.
+ * @param tree tree context, receives the union.
+ * @return 0 on success, -1 if the trees are not compatible.
+ * @note elements of other equal to an element of tree are deleted with the other destroy
+ * function. Set operations split and join subtrees in O(m log (n / m + 1)) for trees of m and
+ * n elements and hand large subtrees to other threads, so that comparison and augmentation
+ * functions must be thread-safe. Nodes are only freed once all threads are done.
+ */
+int rb_union (struct rbtree* other, struct rbtree* tree);
+
+/**
+ * @brief keeps in the tree only the elements also found in another tree.
+ * @param other tree consumed by the operation, left empty.
+ * @param tree tree context, receives the intersection.
+ * @return 0 on success, -1 if the trees are not compatible.
+ * @note elements of tree left out are deleted with the tree destroy function, all elements of
+ * other with its own destroy function.
+ */
+int rb_intersect (struct rbtree* other, struct rbtree* tree);
+
+/**
+ * @brief removes from the tree the elements found in another tree.
+ * @param other tree consumed by the operation, left empty.
+ * @param tree tree context, receives the difference.
+ * @return 0 on success, -1 if the trees are not compatible.
+ * @note elements of tree removed are deleted with the tree destroy function, all elements of
+ * other with its own destroy function.
+ */
+int rb_difference (struct rbtree* other, struct rbtree* tree);
+
+/**
+ * @brief finds the element of the given rank.
+ * @param k rank of the element, starting at 0 for the smallest.
+ * @param tree tree context.
+ * @return element found, NULL if k is out of range.
+ * @note O(log n) for RB_RANK trees, O(k) otherwise.
+ */
+void* rb_select (size_t k, struct rbtree* tree);
+
+/**
+ * @brief returns the rank of an element.
+ * @param data element to compare to.
+ * @param tree tree context.
+ * @return number of elements ordered before the given one.
+ * @note O(log n) for RB_RANK trees, O(rank) otherwise.
+ */
+size_t rb_rank (const void* data, struct rbtree* tree);
+
+/**
+ * @brief counts the elements equal to the given one.
+ * @param data element to compare to.
+ * @param tree tree context.
+ * @return number of equal elements, at most 1 unless the tree is RB_MULTI.
+ * @note O(log n) for RB_RANK trees, O(log n + count) otherwise.
+ */
+size_t rb_count_key (const void* data, struct rbtree* tree);
+
+/**
+ * @brief read the operation counters of the tree.
+ * @param tree tree context.
+ * @param out counters.
+ * @return 0 on success, -1 if counters are not compiled in (out is zeroed).
+ * @note counters only exist when the library and its users are built with RB_STATS defined,
+ * otherwise they compile away. Joins, splits and set operations are not counted.
+ * @note counters are plain increments made by lookups and iteration as well as updates, RB_STATS
+ * builds are for trees used by a single thread, readers sharing a lock would race on them.
+ */
+int rb_stats (struct rbtree* tree, struct rbstats* out);
+
+/**
+ * @brief clear the operation counters of the tree.
+ * @param tree tree context.
+ */
+void rb_stats_reset (struct rbtree* tree);
+
 /**
  * @brief checks whether the tree is empty.
  * @param tree tree context.
@@ -0,0 +1,163 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2023 Mathieu Rabine
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _RBVERSION_H_
+#define _RBVERSION_H_
+
+// rbtree.
+#include <rbtree.h>
+
+/// maximum height of a version, twice the bits of a size.
+#define RB_VERSION_DEPTH 128
+
+/**
+ * @brief node shared between versions.
+ */
+struct rbvnode
+{
+    struct rbvnode* link[2];    // subtrees.
+    void*          data;        // data.
+    unsigned int   refs;        // number of parents and versions holding the node.
+    int            red;         // color: red 1, black 0.
+};
+
+/**
+ * @brief node store shared by all versions derived from the same empty version.
+ */
+struct rbvstore
+{
+    rb_compare*    comp;        // compare elements.
+    unsigned int   refs;        // number of versions using the store.
+    struct rbvnode* spare;      // nodes reserved for the next update, chained through link[0].
+    size_t         nspare;      // number of spare nodes.
+};
+
+/**
+ * @brief immutable version of a tree.
+ */
+struct rbversion
+{
+    struct rbvstore* store;     // node store.
+    struct rbvnode* root;       // root node.
+    size_t         count;       // number of nodes.
+};
+
+/**
+ * @brief iterator over a version.
+ */
+struct rbvsiter
+{
+    struct rbvnode* stack[RB_VERSION_DEPTH];  // path to the current node, without its right turns.
+    int            depth;       // number of nodes in the stack.
+};
+
+/**
+ * @brief create an empty version.
+ * @param compare comparison function.
+ * @return version handle.
+ * @note versions never own their elements, which must outlive every version holding them.
+ * Updates return new versions sharing all untouched nodes with the old one, only the O(log n)
+ * nodes along the updated path are copied, and nodes are freed when the last version holding
+ * them is deleted. Versions can be read and deleted from any thread, updates of versions
+ * derived from the same empty version must be serialized.
+ */
+struct rbversion* rb_version_new (rb_compare* compare);
+
+/**
+ * @brief delete a version handle, nodes only held by it are freed.
+ * @param version version handle.
+ */
+void rb_version_delete (struct rbversion* version);
+
+/**
+ * @brief take a snapshot of a version in O(1).
+ * @param version version handle.
+ * @return new handle on the same version.
+ */
+struct rbversion* rb_version_snapshot (const struct rbversion* version);
+
+/**
+ * @brief insert element in a new version.
+ * @param data element to insert.
+ * @param version version handle, left unchanged.
+ * @return new version, NULL if the element is already there or out of memory.
+ */
+struct rbversion* rb_version_insert (void* data, const struct rbversion* version);
+
+/**
+ * @brief remove element in a new version.
+ * @param data element to remove.
+ * @param version version handle, left unchanged.
+ * @return new version, a snapshot if the element is not there, NULL if out of memory.
+ */
+struct rbversion* rb_version_remove (const void* data, const struct rbversion* version);
+
+/**
+ * @brief finds element in a version.
+ * @param data element to find.
+ * @param version version handle.
+ * @return element found.
+ */
+void* rb_version_find (const void* data, const struct rbversion* version);
+
+/**
+ * @brief returns the number of elements in a version.
+ * @param version version handle.
+ * @return the number of elements.
+ */
+size_t rb_version_size (const struct rbversion* version);
+
+/**
+ * @brief move iterator on first element of a version.
+ * @param it iterator.
+ * @param version version handle, must outlive the iteration.
+ * @return first element, NULL if empty.
+ * @note shared nodes have no parent pointer, the iterator keeps the path in a stack instead.
+ */
+void* vs_beg  (struct rbvsiter* it, const struct rbversion* version);
+
+/**
+ * @brief move iterator on the first element not ordered before the given one.
+ * @param it iterator.
+ * @param version version handle, must outlive the iteration.
+ * @param data element to compare to.
+ * @return first element greater or equal, NULL if none.
+ */
+void* vs_seek (struct rbvsiter* it, const struct rbversion* version, const void* data);
+
+/**
+ * @brief move iterator to the next element.
+ * @param it iterator.
+ * @return next element, NULL at the end.
+ */
+void* vs_next (struct rbvsiter* it);
+
+/**
+ * @brief get current element pointed by iterator.
+ * @param it iterator.
+ * @return current element.
+ */
+void* vs_cur  (struct rbvsiter* it);
+
+#endif
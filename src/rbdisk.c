@@ -0,0 +1,611 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2023 Mathieu Rabine
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// rbtree.
+#include <rbdisk.h>
+#include <rbiter.h>
+
+// C.
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/// file magic.
+#define RB_DISK_MAGIC   "RBTREE\r\n"
+
+/// byte order marker.
+#define RB_DISK_ORDER   0x01020304
+
+/// size of the write buffer.
+#define RB_DISK_BUFFER  (1 << 16)
+
+/// round up to a multiple of a power of two.
+#define ALIGN(size, align) (((size) + (align) - 1) & ~((uint64_t)(align) - 1))
+
+/**
+ * @brief buffered section writer.
+ */
+struct rbdiskout
+{
+    int            fd;          // file descriptor.
+    uint64_t       offset;      // file offset of the buffer.
+    char*          buf;         // buffer.
+    size_t         cap;         // buffer capacity.
+    size_t         len;         // buffered bytes.
+    uint32_t       crc;         // crc32 of the flushed bytes.
+    const uint32_t* table;      // crc32 table.
+};
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : crc_table
+// =========================================================================
+void crc_table (uint32_t* table)
+{
+    for (uint32_t i = 0; i < 256; ++i)
+    {
+        uint32_t crc = i;
+
+        for (int k = 0; k < 8; ++k)
+        {
+            crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+        }
+
+        table[i] = crc;
+    }
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : crc_update
+// =========================================================================
+uint32_t crc_update (uint32_t crc, const void* data, size_t size, const uint32_t* table)
+{
+    const unsigned char* p = data;
+
+    crc = ~crc;
+
+    while (size--)
+    {
+        crc = table[(crc ^ *p++) & 0xff] ^ (crc >> 8);
+    }
+
+    return ~crc;
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : write_at
+// =========================================================================
+int write_at (int fd, const void* data, size_t size, uint64_t offset)
+{
+    const char* p = data;
+
+    while (size > 0)
+    {
+        ssize_t n = pwrite (fd, p, size, (off_t)offset);
+
+        if (n <= 0)
+        {
+            return -1;
+        }
+
+        p += n;
+        size -= (size_t)n;
+        offset += (uint64_t)n;
+    }
+
+    return 0;
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : out_flush
+// =========================================================================
+int out_flush (struct rbdiskout* out)
+{
+    if (write_at (out->fd, out->buf, out->len, out->offset) != 0)
+    {
+        return -1;
+    }
+
+    out->crc = crc_update (out->crc, out->buf, out->len, out->table);
+    out->offset += out->len;
+    out->len = 0;
+
+    return 0;
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : out_record
+// =========================================================================
+int out_record (const void* data, rb_serialize* serialize, uint64_t* at, struct rbdiskout* out)
+{
+    // the length must fit before anything is serialized behind it.
+    if (out->cap - out->len < 8 && out_flush (out) != 0)
+    {
+        return -1;
+    }
+
+    // serialize in place behind the length, flush or grow the buffer when the padded record does not fit.
+    size_t avail = out->cap - out->len - 8;
+    size_t size = serialize (data, out->buf + out->len + 8, avail);
+
+    if (ALIGN (size, 8) > avail)
+    {
+        if (out_flush (out) != 0)
+        {
+            return -1;
+        }
+
+        if (ALIGN (size, 8) > out->cap - 8)
+        {
+            size_t cap = ALIGN (size + 16, RB_DISK_BUFFER);
+            char* buf = realloc (out->buf, cap);
+
+            if (buf == NULL)
+            {
+                return -1;
+            }
+
+            out->buf = buf;
+            out->cap = cap;
+        }
+
+        if (serialize (data, out->buf + 8, out->cap - 8) != size)
+        {
+            return -1;
+        }
+    }
+
+    uint64_t length = size;
+    size_t padded = ALIGN (size, 8);
+
+    memcpy (out->buf + out->len, &length, 8);
+    memset (out->buf + out->len + 8 + size, 0, padded - size);
+
+    *at = out->offset + out->len + 8;
+    out->len += 8 + padded;
+
+    return 0;
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : write_sections
+// =========================================================================
+int write_sections (rb_serialize* serialize, struct rbdiskheader* header, struct rbdiskout* index, struct rbdiskout* blob, struct rbtree* tree)
+{
+    struct rbiter it;
+
+    for (void* data = it_beg (&it, tree); data != NULL; data = it_next (&it))
+    {
+        uint64_t at;
+
+        if (out_record (data, serialize, &at, blob) != 0)
+        {
+            return -1;
+        }
+
+        if (index->len == index->cap && out_flush (index) != 0)
+        {
+            return -1;
+        }
+
+        // offsets are relative to the blob section.
+        at -= header->blob;
+        memcpy (index->buf + index->len, &at, sizeof (at));
+        index->len += sizeof (at);
+    }
+
+    if (out_flush (index) != 0 || out_flush (blob) != 0)
+    {
+        return -1;
+    }
+
+    header->blob_size = blob->offset - header->blob;
+    header->index_crc = index->crc;
+    header->blob_crc = blob->crc;
+    header->header_crc = crc_update (0, header, offsetof (struct rbdiskheader, header_crc), index->table);
+
+    // the sections must be on disk before a valid header can point to them, the size covers
+    // the index padding of an empty blob.
+    if (ftruncate (index->fd, (off_t)(header->blob + header->blob_size)) != 0
+        || fsync (index->fd) != 0 || write_at (index->fd, header, sizeof (*header), 0) != 0)
+    {
+        return -1;
+    }
+
+    return fsync (index->fd);
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rb_disk_write
+// =========================================================================
+int rb_disk_write (const char* path, rb_serialize* serialize, struct rbtree* tree)
+{
+    if (path == NULL || serialize == NULL || tree == NULL)
+    {
+        return -1;
+    }
+
+    uint32_t table[256];
+    crc_table (table);
+
+    struct rbdiskheader header;
+    memset (&header, 0, sizeof (header));
+    memcpy (header.magic, RB_DISK_MAGIC, sizeof (header.magic));
+    header.version = RB_DISK_VERSION;
+    header.order = RB_DISK_ORDER;
+    header.count = rb_size (tree);
+    header.index = RB_DISK_PAGE;
+    header.index_size = header.count * sizeof (uint64_t);
+    header.blob = header.index + ALIGN (header.index_size, RB_DISK_PAGE);
+
+    struct rbdiskout index = {-1, header.index, malloc (RB_DISK_BUFFER), RB_DISK_BUFFER, 0, 0, table};
+    struct rbdiskout blob = {-1, header.blob, malloc (RB_DISK_BUFFER), RB_DISK_BUFFER, 0, 0, table};
+    int ret = -1;
+
+    if (index.buf != NULL && blob.buf != NULL)
+    {
+        int fd = open (path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+        if (fd != -1)
+        {
+            index.fd = blob.fd = fd;
+            ret = write_sections (serialize, &header, &index, &blob, tree);
+
+            if (close (fd) != 0)
+            {
+                ret = -1;
+            }
+        }
+    }
+
+    free (index.buf);
+    free (blob.buf);
+
+    return ret;
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : check_header
+// =========================================================================
+int check_header (const struct rbdiskheader* header, size_t size)
+{
+    uint32_t table[256];
+    crc_table (table);
+
+    if (memcmp (header->magic, RB_DISK_MAGIC, sizeof (header->magic)) != 0
+        || header->version != RB_DISK_VERSION || header->order != RB_DISK_ORDER
+        || header->header_crc != crc_update (0, header, offsetof (struct rbdiskheader, header_crc), table))
+    {
+        return -1;
+    }
+
+    // sections must be aligned, ordered and inside the file.
+    if (header->index % RB_DISK_PAGE != 0 || header->blob % RB_DISK_PAGE != 0
+        || header->index < RB_DISK_PAGE || header->count > (SIZE_MAX - RB_DISK_PAGE) / sizeof (uint64_t)
+        || header->index_size != header->count * sizeof (uint64_t)
+        || header->index > header->blob || header->index_size > header->blob - header->index
+        || header->blob > size || header->blob_size > size - header->blob)
+    {
+        return -1;
+    }
+
+    return 0;
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rb_disk_open
+// =========================================================================
+struct rbdisk* rb_disk_open (const char* path, rb_compare* compare)
+{
+    if (path == NULL || compare == NULL)
+    {
+        return NULL;
+    }
+
+    int fd = open (path, O_RDONLY);
+
+    if (fd == -1)
+    {
+        return NULL;
+    }
+
+    struct stat st;
+    void* map = MAP_FAILED;
+
+    if (fstat (fd, &st) == 0 && st.st_size >= RB_DISK_PAGE)
+    {
+        map = mmap (NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    }
+
+    // the mapping keeps its own reference to the file.
+    close (fd);
+
+    if (map == MAP_FAILED)
+    {
+        return NULL;
+    }
+
+    struct rbdisk* disk = malloc (sizeof (struct rbdisk));
+
+    if (disk == NULL || check_header (map, (size_t)st.st_size) != 0)
+    {
+        munmap (map, (size_t)st.st_size);
+        free (disk);
+        return NULL;
+    }
+
+    disk->comp = compare;
+    disk->header = map;
+    disk->size = (size_t)st.st_size;
+    disk->count = disk->header->count;
+    disk->index = (const uint64_t*)((const char*)map + disk->header->index);
+    disk->blob = (const char*)map + disk->header->blob;
+
+    // lookups jump around, read ahead would fault in pages that are never used.
+    madvise (map, disk->size, MADV_RANDOM);
+
+    return disk;
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rb_disk_close
+// =========================================================================
+void rb_disk_close (struct rbdisk* disk)
+{
+    if (disk != NULL)
+    {
+        munmap ((void*)disk->header, disk->size);
+        free (disk);
+    }
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rb_disk_verify
+// =========================================================================
+int rb_disk_verify (const struct rbdisk* disk)
+{
+    if (disk == NULL)
+    {
+        return -1;
+    }
+
+    uint32_t table[256];
+    crc_table (table);
+
+    if (crc_update (0, disk->index, disk->header->index_size, table) != disk->header->index_crc
+        || crc_update (0, disk->blob, disk->header->blob_size, table) != disk->header->blob_crc)
+    {
+        return -1;
+    }
+
+    // a matching checksum may still come from a buggy writer, check bounds and order too, equal
+    // records come from RB_MULTI trees.
+    for (size_t i = 0; i < disk->count; ++i)
+    {
+        uint64_t at = disk->index[i];
+
+        if (at < 8 || at % 8 != 0 || at > disk->header->blob_size
+            || rb_disk_length (disk->blob + at) > disk->header->blob_size - at)
+        {
+            return -1;
+        }
+
+        if (i > 0 && disk->comp (disk->blob + disk->index[i - 1], disk->blob + at) > 0)
+        {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : disk_bound
+// =========================================================================
+size_t disk_bound (const void* data, int upper, const struct rbdisk* disk)
+{
+    size_t lo = 0, hi = disk->count;
+
+    // first position whose element compares greater, or greater or equal.
+    while (lo < hi)
+    {
+        size_t mid = lo + (hi - lo) / 2;
+        int comp = disk->comp (disk->blob + disk->index[mid], data);
+
+        if (comp < 0 || (upper && comp == 0))
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    return lo;
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : disk_item
+// =========================================================================
+void* disk_item (size_t index, const struct rbdisk* disk)
+{
+    return (index < disk->count) ? (void*)(disk->blob + disk->index[index]) : NULL;
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rb_disk_find
+// =========================================================================
+void* rb_disk_find (const void* data, const struct rbdisk* disk)
+{
+    void* found = rb_disk_lower_bound (data, disk);
+
+    return (found != NULL && disk->comp (found, data) == 0) ? found : NULL;
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rb_disk_lower_bound
+// =========================================================================
+void* rb_disk_lower_bound (const void* data, const struct rbdisk* disk)
+{
+    return (disk != NULL) ? disk_item (disk_bound (data, 0, disk), disk) : NULL;
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rb_disk_upper_bound
+// =========================================================================
+void* rb_disk_upper_bound (const void* data, const struct rbdisk* disk)
+{
+    return (disk != NULL) ? disk_item (disk_bound (data, 1, disk), disk) : NULL;
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rb_disk_size
+// =========================================================================
+size_t rb_disk_size (const struct rbdisk* disk)
+{
+    return (disk != NULL) ? disk->count : 0;
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rb_disk_length
+// =========================================================================
+size_t rb_disk_length (const void* data)
+{
+    uint64_t length;
+
+    memcpy (&length, (const char*)data - 8, sizeof (length));
+
+    return (size_t)length;
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : dk_beg
+// =========================================================================
+void* dk_beg (struct rbdiskiter* it, const struct rbdisk* disk)
+{
+    if (it == NULL || disk == NULL)
+    {
+        return NULL;
+    }
+
+    it->disk = disk;
+    it->index = 0;
+
+    return dk_cur (it);
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : dk_end
+// =========================================================================
+void* dk_end (struct rbdiskiter* it, const struct rbdisk* disk)
+{
+    if (it == NULL || disk == NULL)
+    {
+        return NULL;
+    }
+
+    it->disk = disk;
+    it->index = (disk->count > 0) ? disk->count - 1 : 0;
+
+    return dk_cur (it);
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : dk_seek
+// =========================================================================
+void* dk_seek (struct rbdiskiter* it, const struct rbdisk* disk, const void* data)
+{
+    if (it == NULL || disk == NULL)
+    {
+        return NULL;
+    }
+
+    it->disk = disk;
+    it->index = disk_bound (data, 0, disk);
+
+    return dk_cur (it);
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : dk_next
+// =========================================================================
+void* dk_next (struct rbdiskiter* it)
+{
+    if (it == NULL || it->index >= it->disk->count)
+    {
+        return NULL;
+    }
+
+    ++it->index;
+
+    return dk_cur (it);
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : dk_prev
+// =========================================================================
+void* dk_prev (struct rbdiskiter* it)
+{
+    if (it == NULL || it->index >= it->disk->count)
+    {
+        return NULL;
+    }
+
+    // stepping before the first element leaves the iterator past the ends.
+    it->index = (it->index > 0) ? it->index - 1 : it->disk->count;
+
+    return dk_cur (it);
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : dk_cur
+// =========================================================================
+void* dk_cur (struct rbdiskiter* it)
+{
+    return (it != NULL) ? disk_item (it->index, it->disk) : NULL;
+}
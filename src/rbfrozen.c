@@ -0,0 +1,713 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2023 Mathieu Rabine
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// rbtree.
+#include <rbfrozen.h>
+#include <rbiter.h>
+
+// C.
+#include <stdlib.h>
+#include <string.h>
+
+#if defined (__x86_64__) || defined (__i386__)
+#include <immintrin.h>
+#define RB_X86
+#endif
+
+#if defined (__GNUC__)
+#define prefetch(addr) __builtin_prefetch (addr)
+#else
+#define prefetch(addr) ((void)(addr))
+#endif
+
+/// number of keys of a block, one cache line.
+#define BLOCK(type) (64 / sizeof (type))
+
+/// index search over blocks, each level counts the keys lower than the searched one.
+#define SEARCH(name, type, rank, attr)                                                          \
+    attr size_t name (const void* keys, size_t nblocks, const void* key)                        \
+    {                                                                                           \
+        const type* base = keys;                                                                \
+        type x = *(const type*)key;                                                             \
+        size_t block = 0, slot = SIZE_MAX;                                                      \
+                                                                                                \
+        while (block < nblocks)                                                                 \
+        {                                                                                       \
+            size_t j = rank (base + block * BLOCK (type), x);                                   \
+            slot = (j < BLOCK (type)) ? block * BLOCK (type) + j : slot;                        \
+            block = block * (BLOCK (type) + 1) + j + 1;                                         \
+        }                                                                                       \
+                                                                                                \
+        return slot;                                                                            \
+    }
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rank_i32
+// =========================================================================
+static inline size_t rank_i32 (const int32_t* keys, int32_t x)
+{
+    size_t rank = 0;
+
+    for (size_t i = 0; i < BLOCK (int32_t); ++i)
+    {
+        rank += keys[i] < x;
+    }
+
+    return rank;
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rank_i64
+// =========================================================================
+static inline size_t rank_i64 (const int64_t* keys, int64_t x)
+{
+    size_t rank = 0;
+
+    for (size_t i = 0; i < BLOCK (int64_t); ++i)
+    {
+        rank += keys[i] < x;
+    }
+
+    return rank;
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rank_u64
+// =========================================================================
+static inline size_t rank_u64 (const uint64_t* keys, uint64_t x)
+{
+    size_t rank = 0;
+
+    for (size_t i = 0; i < BLOCK (uint64_t); ++i)
+    {
+        rank += keys[i] < x;
+    }
+
+    return rank;
+}
+
+SEARCH (search_i32, int32_t, rank_i32, )
+SEARCH (search_i64, int64_t, rank_i64, )
+SEARCH (search_u64, uint64_t, rank_u64, )
+
+#if defined (RB_X86)
+
+#define SSE     __attribute__ ((target ("sse4.2")))
+#define AVX2    __attribute__ ((target ("avx2")))
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rank_i32_sse
+// =========================================================================
+static inline SSE size_t rank_i32_sse (const int32_t* keys, int32_t x)
+{
+    __m128i v = _mm_set1_epi32 (x);
+    size_t rank = 0;
+
+    for (int i = 0; i < 4; ++i)
+    {
+        __m128i lt = _mm_cmpgt_epi32 (v, _mm_load_si128 ((const __m128i*)keys + i));
+        rank += __builtin_popcount (_mm_movemask_ps (_mm_castsi128_ps (lt)));
+    }
+
+    return rank;
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rank_i64_sse
+// =========================================================================
+static inline SSE size_t rank_i64_sse (const int64_t* keys, int64_t x)
+{
+    __m128i v = _mm_set1_epi64x (x);
+    size_t rank = 0;
+
+    for (int i = 0; i < 4; ++i)
+    {
+        __m128i lt = _mm_cmpgt_epi64 (v, _mm_load_si128 ((const __m128i*)keys + i));
+        rank += __builtin_popcount (_mm_movemask_pd (_mm_castsi128_pd (lt)));
+    }
+
+    return rank;
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rank_u64_sse
+// =========================================================================
+static inline SSE size_t rank_u64_sse (const uint64_t* keys, uint64_t x)
+{
+    // flip the sign bits so that a signed compare orders unsigned values.
+    __m128i sign = _mm_set1_epi64x (INT64_MIN);
+    __m128i v = _mm_xor_si128 (_mm_set1_epi64x ((int64_t)x), sign);
+    size_t rank = 0;
+
+    for (int i = 0; i < 4; ++i)
+    {
+        __m128i k = _mm_xor_si128 (_mm_load_si128 ((const __m128i*)keys + i), sign);
+        rank += __builtin_popcount (_mm_movemask_pd (_mm_castsi128_pd (_mm_cmpgt_epi64 (v, k))));
+    }
+
+    return rank;
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rank_i32_avx2
+// =========================================================================
+static inline AVX2 size_t rank_i32_avx2 (const int32_t* keys, int32_t x)
+{
+    __m256i v = _mm256_set1_epi32 (x);
+    __m256i lo = _mm256_cmpgt_epi32 (v, _mm256_load_si256 ((const __m256i*)keys));
+    __m256i hi = _mm256_cmpgt_epi32 (v, _mm256_load_si256 ((const __m256i*)keys + 1));
+
+    return __builtin_popcount (_mm256_movemask_ps (_mm256_castsi256_ps (lo))) +
+           __builtin_popcount (_mm256_movemask_ps (_mm256_castsi256_ps (hi)));
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rank_i64_avx2
+// =========================================================================
+static inline AVX2 size_t rank_i64_avx2 (const int64_t* keys, int64_t x)
+{
+    __m256i v = _mm256_set1_epi64x (x);
+    __m256i lo = _mm256_cmpgt_epi64 (v, _mm256_load_si256 ((const __m256i*)keys));
+    __m256i hi = _mm256_cmpgt_epi64 (v, _mm256_load_si256 ((const __m256i*)keys + 1));
+
+    return __builtin_popcount (_mm256_movemask_pd (_mm256_castsi256_pd (lo))) +
+           __builtin_popcount (_mm256_movemask_pd (_mm256_castsi256_pd (hi)));
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rank_u64_avx2
+// =========================================================================
+static inline AVX2 size_t rank_u64_avx2 (const uint64_t* keys, uint64_t x)
+{
+    __m256i sign = _mm256_set1_epi64x (INT64_MIN);
+    __m256i v = _mm256_xor_si256 (_mm256_set1_epi64x ((int64_t)x), sign);
+    __m256i lo = _mm256_xor_si256 (_mm256_load_si256 ((const __m256i*)keys), sign);
+    __m256i hi = _mm256_xor_si256 (_mm256_load_si256 ((const __m256i*)keys + 1), sign);
+
+    return __builtin_popcount (_mm256_movemask_pd (_mm256_castsi256_pd (_mm256_cmpgt_epi64 (v, lo)))) +
+           __builtin_popcount (_mm256_movemask_pd (_mm256_castsi256_pd (_mm256_cmpgt_epi64 (v, hi))));
+}
+
+SEARCH (search_i32_sse, int32_t, rank_i32_sse, SSE)
+SEARCH (search_i64_sse, int64_t, rank_i64_sse, SSE)
+SEARCH (search_u64_sse, uint64_t, rank_u64_sse, SSE)
+SEARCH (search_i32_avx2, int32_t, rank_i32_avx2, AVX2)
+SEARCH (search_i64_avx2, int64_t, rank_i64_avx2, AVX2)
+SEARCH (search_u64_avx2, uint64_t, rank_u64_avx2, AVX2)
+
+#endif
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : select_search
+// =========================================================================
+rb_fzsearch* select_search (int type, int* simd)
+{
+    static rb_fzsearch* const table[3][3] =
+    {
+        {search_i32, search_i64, search_u64},
+#if defined (RB_X86)
+        {search_i32_sse, search_i64_sse, search_u64_sse},
+        {search_i32_avx2, search_i64_avx2, search_u64_avx2},
+#else
+        {search_i32, search_i64, search_u64},
+        {search_i32, search_i64, search_u64},
+#endif
+    };
+
+    int level = (*simd == RB_SIMD_AUTO) ? RB_SIMD_AVX2 : *simd;
+
+#if defined (RB_X86)
+    __builtin_cpu_init ();
+
+    if (level >= RB_SIMD_AVX2 && !__builtin_cpu_supports ("avx2"))
+        level = RB_SIMD_SSE;
+    if (level >= RB_SIMD_SSE && !__builtin_cpu_supports ("sse4.2"))
+        level = RB_SIMD_NONE;
+#else
+    level = RB_SIMD_NONE;
+#endif
+
+    *simd = level;
+
+    return table[level - RB_SIMD_NONE][type - RB_KEY_I32];
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : fill_keys
+// =========================================================================
+void fill_keys (size_t block, size_t width, size_t offset, struct rbfrozen* frozen, struct rbfziter* it)
+{
+    size_t per = 64 / width;
+
+    if (block < frozen->nblocks)
+    {
+        for (size_t j = 0; j <= per; ++j)
+        {
+            fill_keys (block * (per + 1) + j + 1, width, offset, frozen, it);
+
+            if (j < per)
+            {
+                size_t slot = block * per + j;
+                char* key = (char*)frozen->keys + slot * width;
+                void* data = fz_cur (it);
+
+                frozen->slots[slot] = data;
+
+                if (data != NULL)
+                {
+                    memcpy (key, (char*)data + offset, width);
+                    fz_next (it);
+                }
+                else
+                {
+                    // padding sorts after every key, and ties resolve to real elements which come first.
+                    if (frozen->key_type == RB_KEY_I32)
+                        *(int32_t*)key = INT32_MAX;
+                    else if (frozen->key_type == RB_KEY_I64)
+                        *(int64_t*)key = INT64_MAX;
+                    else
+                        *(uint64_t*)key = UINT64_MAX;
+                }
+            }
+        }
+    }
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : index_bound
+// =========================================================================
+void* index_bound (int type, const void* key, int exact, const struct rbfrozen* frozen)
+{
+    if (frozen == NULL || frozen->key_type != type)
+    {
+        return NULL;
+    }
+
+    size_t slot = frozen->search (frozen->keys, frozen->nblocks, key);
+
+    if (slot == SIZE_MAX || frozen->slots[slot] == NULL)
+    {
+        return NULL;
+    }
+
+    size_t width = (type == RB_KEY_I32) ? sizeof (int32_t) : sizeof (int64_t);
+
+    if (exact && memcmp ((char*)frozen->keys + slot * width, key, width) != 0)
+    {
+        return NULL;
+    }
+
+    return frozen->slots[slot];
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : fill_items
+// =========================================================================
+void fill_items (void** items, uint32_t index, uint32_t count, struct rbiter* it)
+{
+    // an in-order walk of the implicit tree consumes the elements in order.
+    if (index <= count)
+    {
+        fill_items (items, 2 * index, count, it);
+        items[index] = it_cur (it);
+        it_next (it);
+        fill_items (items, 2 * index + 1, count, it);
+    }
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : bound_index
+// =========================================================================
+uint32_t bound_index (const void* data, int upper, const struct rbfrozen* frozen)
+{
+    uint64_t index = 1;
+
+    // branch free descent, the prefetch fetches the 16 descendants four levels down.
+    while (index <= frozen->count)
+    {
+        prefetch (frozen->items + 16 * index);
+        int comp = frozen->comp (frozen->items[index], data);
+        index = 2 * index + (comp < 0 || (upper && comp == 0));
+    }
+
+    // the bound is the last node where the descent went left, drop the right turns after it.
+    index >>= __builtin_ctzll (~index) + 1;
+
+    return (uint32_t)index;
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rb_freeze
+// =========================================================================
+struct rbfrozen* rb_freeze (struct rbtree* tree)
+{
+    if (tree == NULL || tree->count > UINT32_MAX - 1)
+    {
+        return NULL;
+    }
+
+    struct rbfrozen* frozen = malloc (sizeof (struct rbfrozen));
+
+    if (frozen != NULL)
+    {
+        size_t size = ((tree->count + 1) * sizeof (void*) + 63) & ~(size_t)63;
+
+        frozen->comp = tree->comp;
+        frozen->count = (uint32_t)tree->count;
+        frozen->key_type = 0;
+        frozen->simd = RB_SIMD_NONE;
+        frozen->nblocks = 0;
+        frozen->keys = NULL;
+        frozen->slots = NULL;
+        frozen->search = NULL;
+        frozen->items = aligned_alloc (64, size);
+
+        if (frozen->items == NULL)
+        {
+            free (frozen);
+            return NULL;
+        }
+
+        struct rbiter it;
+
+        frozen->items[0] = NULL;
+        it_beg (&it, tree);
+        fill_items (frozen->items, 1, frozen->count, &it);
+    }
+
+    return frozen;
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rb_frozen_delete
+// =========================================================================
+void rb_frozen_delete (struct rbfrozen* frozen)
+{
+    if (frozen != NULL)
+    {
+        free (frozen->keys);
+        free (frozen->slots);
+        free (frozen->items);
+        free (frozen);
+    }
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rb_frozen_find
+// =========================================================================
+void* rb_frozen_find (const void* data, const struct rbfrozen* frozen)
+{
+    if (frozen != NULL)
+    {
+        uint32_t index = bound_index (data, 0, frozen);
+
+        if (index != 0 && frozen->comp (frozen->items[index], data) == 0)
+        {
+            return frozen->items[index];
+        }
+    }
+
+    return NULL;
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rb_frozen_lower_bound
+// =========================================================================
+void* rb_frozen_lower_bound (const void* data, const struct rbfrozen* frozen)
+{
+    return (frozen != NULL) ? frozen->items[bound_index (data, 0, frozen)] : NULL;
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rb_frozen_upper_bound
+// =========================================================================
+void* rb_frozen_upper_bound (const void* data, const struct rbfrozen* frozen)
+{
+    return (frozen != NULL) ? frozen->items[bound_index (data, 1, frozen)] : NULL;
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rb_frozen_size
+// =========================================================================
+size_t rb_frozen_size (const struct rbfrozen* frozen)
+{
+    return (frozen != NULL) ? frozen->count : 0;
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rb_frozen_index
+// =========================================================================
+int rb_frozen_index (int type, size_t offset, int simd, struct rbfrozen* frozen)
+{
+    if (frozen == NULL || type < RB_KEY_I32 || type > RB_KEY_U64 || simd < RB_SIMD_AUTO || simd > RB_SIMD_AVX2)
+    {
+        return -1;
+    }
+
+    size_t width = (type == RB_KEY_I32) ? sizeof (int32_t) : sizeof (int64_t);
+    size_t nblocks = (frozen->count + 64 / width - 1) / (64 / width);
+    void* keys = aligned_alloc (64, (nblocks > 0 ? nblocks : 1) * 64);
+    void** slots = malloc ((nblocks > 0 ? nblocks : 1) * (64 / width) * sizeof (void*));
+
+    if (keys == NULL || slots == NULL)
+    {
+        free (keys);
+        free (slots);
+        return -1;
+    }
+
+    free (frozen->keys);
+    free (frozen->slots);
+
+    frozen->key_type = type;
+    frozen->simd = simd;
+    frozen->nblocks = nblocks;
+    frozen->keys = keys;
+    frozen->slots = slots;
+    frozen->search = select_search (type, &frozen->simd);
+
+    struct rbfziter it;
+
+    fz_beg (&it, frozen);
+    fill_keys (0, width, offset, frozen, &it);
+
+    return 0;
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rb_frozen_find_i32
+// =========================================================================
+void* rb_frozen_find_i32 (int32_t key, const struct rbfrozen* frozen)
+{
+    return index_bound (RB_KEY_I32, &key, 1, frozen);
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rb_frozen_find_i64
+// =========================================================================
+void* rb_frozen_find_i64 (int64_t key, const struct rbfrozen* frozen)
+{
+    return index_bound (RB_KEY_I64, &key, 1, frozen);
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rb_frozen_find_u64
+// =========================================================================
+void* rb_frozen_find_u64 (uint64_t key, const struct rbfrozen* frozen)
+{
+    return index_bound (RB_KEY_U64, &key, 1, frozen);
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rb_frozen_lower_bound_i32
+// =========================================================================
+void* rb_frozen_lower_bound_i32 (int32_t key, const struct rbfrozen* frozen)
+{
+    return index_bound (RB_KEY_I32, &key, 0, frozen);
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rb_frozen_lower_bound_i64
+// =========================================================================
+void* rb_frozen_lower_bound_i64 (int64_t key, const struct rbfrozen* frozen)
+{
+    return index_bound (RB_KEY_I64, &key, 0, frozen);
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rb_frozen_lower_bound_u64
+// =========================================================================
+void* rb_frozen_lower_bound_u64 (uint64_t key, const struct rbfrozen* frozen)
+{
+    return index_bound (RB_KEY_U64, &key, 0, frozen);
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : fz_beg
+// =========================================================================
+void* fz_beg (struct rbfziter* it, const struct rbfrozen* frozen)
+{
+    if (it == NULL || frozen == NULL)
+    {
+        return NULL;
+    }
+
+    uint64_t index = (frozen->count > 0) ? 1 : 0;
+
+    while (index != 0 && 2 * index <= frozen->count)
+    {
+        index = 2 * index;
+    }
+
+    it->frozen = frozen;
+    it->index = (uint32_t)index;
+
+    return frozen->items[index];
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : fz_end
+// =========================================================================
+void* fz_end (struct rbfziter* it, const struct rbfrozen* frozen)
+{
+    if (it == NULL || frozen == NULL)
+    {
+        return NULL;
+    }
+
+    uint64_t index = (frozen->count > 0) ? 1 : 0;
+
+    while (index != 0 && 2 * index + 1 <= frozen->count)
+    {
+        index = 2 * index + 1;
+    }
+
+    it->frozen = frozen;
+    it->index = (uint32_t)index;
+
+    return frozen->items[index];
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : fz_seek
+// =========================================================================
+void* fz_seek (struct rbfziter* it, const struct rbfrozen* frozen, const void* data)
+{
+    if (it == NULL || frozen == NULL)
+    {
+        return NULL;
+    }
+
+    it->frozen = frozen;
+    it->index = bound_index (data, 0, frozen);
+
+    return frozen->items[it->index];
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : fz_next
+// =========================================================================
+void* fz_next (struct rbfziter* it)
+{
+    if (it == NULL || it->index == 0)
+    {
+        return NULL;
+    }
+
+    uint64_t index = it->index;
+
+    if (2 * index + 1 <= it->frozen->count)
+    {
+        // leftmost node of the right subtree.
+        index = 2 * index + 1;
+
+        while (2 * index <= it->frozen->count)
+        {
+            index = 2 * index;
+        }
+    }
+    else
+    {
+        // climb while coming from a right child, then once more.
+        index >>= __builtin_ctzll (~index) + 1;
+    }
+
+    it->index = (uint32_t)index;
+
+    return it->frozen->items[index];
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : fz_prev
+// =========================================================================
+void* fz_prev (struct rbfziter* it)
+{
+    if (it == NULL || it->index == 0)
+    {
+        return NULL;
+    }
+
+    uint64_t index = it->index;
+
+    if (2 * index <= it->frozen->count)
+    {
+        // rightmost node of the left subtree.
+        index = 2 * index;
+
+        while (2 * index + 1 <= it->frozen->count)
+        {
+            index = 2 * index + 1;
+        }
+    }
+    else
+    {
+        // climb while coming from a left child, then once more.
+        index >>= __builtin_ctzll (index) + 1;
+    }
+
+    it->index = (uint32_t)index;
+
+    return it->frozen->items[index];
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : fz_cur
+// =========================================================================
+void* fz_cur (struct rbfziter* it)
+{
+    return (it != NULL && it->frozen != NULL) ? it->frozen->items[it->index] : NULL;
+}
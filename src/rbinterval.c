@@ -0,0 +1,150 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2023 Mathieu Rabine
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// rbtree.
+#include <rbinterval.h>
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : interval_compare
+// =========================================================================
+int interval_compare (const void* left, const void* right)
+{
+    const struct rbinterval* l = left;
+    const struct rbinterval* r = right;
+
+    if (l->lo != r->lo)
+        return l->lo < r->lo ? -1 : 1;
+    if (l->hi != r->hi)
+        return l->hi < r->hi ? -1 : 1;
+    if (l != r)
+        return l < r ? -1 : 1;
+
+    return 0;
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : interval_propagate
+// =========================================================================
+void interval_propagate (struct rbnode* node, struct rbtree* tree)
+{
+    struct rbinterval* iv = rb_data (node, tree);
+
+    iv->max = iv->hi;
+
+    for (int dir = 0; dir < 2; ++dir)
+    {
+        if (node->link[dir] != NULL)
+        {
+            struct rbinterval* child = rb_data (node->link[dir], tree);
+            if (child->max > iv->max)
+                iv->max = child->max;
+        }
+    }
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : overlap_nodes
+// =========================================================================
+int overlap_nodes (struct rbnode* node, long lo, long hi, rb_visit* visit, void* ctx, struct rbtree* tree, size_t* count)
+{
+    while (node != NULL)
+    {
+        struct rbinterval* iv = rb_data (node, tree);
+
+        // nothing in this subtree ends after lo.
+        if (iv->max < lo)
+        {
+            return 0;
+        }
+
+        if (overlap_nodes (node->link[0], lo, hi, visit, ctx, tree, count) != 0)
+        {
+            return 1;
+        }
+
+        // this interval and the right subtree start after hi.
+        if (iv->lo > hi)
+        {
+            return 0;
+        }
+
+        if (iv->hi >= lo)
+        {
+            ++*count;
+
+            if (visit (iv, ctx) != 0)
+            {
+                return 1;
+            }
+        }
+
+        node = node->link[1];
+    }
+
+    return 0;
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rb_interval_new
+// =========================================================================
+struct rbtree* rb_interval_new (rb_destroy* destroy)
+{
+    struct rbtree* tree = rb_new (interval_compare, destroy);
+
+    if (tree != NULL)
+    {
+        rb_set_augment (interval_propagate, tree);
+    }
+
+    return tree;
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rb_stab
+// =========================================================================
+size_t rb_stab (long point, rb_visit* visit, void* ctx, struct rbtree* tree)
+{
+    return rb_overlap (point, point, visit, ctx, tree);
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rb_overlap
+// =========================================================================
+size_t rb_overlap (long lo, long hi, rb_visit* visit, void* ctx, struct rbtree* tree)
+{
+    size_t count = 0;
+
+    if (tree != NULL && visit != NULL && lo <= hi)
+    {
+        overlap_nodes (tree->root, lo, hi, visit, ctx, tree, &count);
+    }
+
+    return count;
+}
@@ -34,16 +34,11 @@ void* it_beg (struct rbiter* it, struct rbtree* tree)
     if (it != NULL && tree != NULL)
     {
         it->tree = tree;
-        it->node = tree->root;
+        it->node = tree->ends[0];
 
         if (it->node != NULL)
         {
-            while (it->node->link[0] != NULL)
-            {
-                it->node = it->node->link[0];
-            }
-
-            return it->node->data;
+            return rb_data (it->node, it->tree);
         }
     }
 
@@ -59,22 +54,83 @@ void* it_end (struct rbiter* it, struct rbtree* tree)
     if (it != NULL && tree != NULL)
     {
         it->tree = tree;
-        it->node = tree->root;
+        it->node = tree->ends[1];
 
         if (it->node != NULL)
         {
-            while (it->node->link[1] != NULL)
+            return rb_data (it->node, it->tree);
+        }
+    }
+
+    return NULL;
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : it_seek
+// =========================================================================
+void* it_seek (struct rbiter* it, struct rbtree* tree, const void* data)
+{
+    if (it != NULL && tree != NULL)
+    {
+        struct rbnode* node = tree->root;
+
+        it->tree = tree;
+        it->node = NULL;
+
+        while (node != NULL)
+        {
+            if (tree->comp (rb_data (node, tree), data) < 0)
             {
-                it->node = it->node->link[1];
+                node = node->link[1];
+            }
+            else
+            {
+                it->node = node;
+                node = node->link[0];
             }
-
-            return it->node->data;
         }
+
+        return it->node != NULL ? rb_data (it->node, tree) : NULL;
     }
 
     return NULL;
 }
 
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rb_equal_range
+// =========================================================================
+void* rb_equal_range (const void* data, struct rbiter* first, struct rbiter* last, struct rbtree* tree)
+{
+    if (first == NULL || last == NULL || tree == NULL)
+    {
+        return NULL;
+    }
+
+    struct rbnode* node = tree->root;
+
+    it_seek (first, tree, data);
+
+    last->tree = tree;
+    last->node = NULL;
+
+    while (node != NULL)
+    {
+        if (tree->comp (rb_data (node, tree), data) <= 0)
+        {
+            node = node->link[1];
+        }
+        else
+        {
+            last->node = node;
+            node = node->link[0];
+        }
+    }
+
+    return (first->node != last->node) ? it_cur (first) : NULL;
+}
+
 // =========================================================================
 //   CLASS     :
 //   METHOD    : it_next
@@ -83,6 +139,8 @@ void* it_next (struct rbiter* it)
 {
     if (it != NULL)
     {
+        rb_stat (it->tree, steps, 1);
+
         if (it->node == NULL)
         {
             return it_beg (it, it->tree);
@@ -91,12 +149,12 @@ void* it_next (struct rbiter* it)
         {
             struct rbnode *q, *p;
 
-            for (p = it->node, q = p->parent; ; p = q, q = q->parent)
+            for (p = it->node, q = rb_parent (p); ; p = q, q = rb_parent (q))
             {
                 if (q == NULL || p == q->link[0])
                 {
                     it->node = q;
-                    return it->node != NULL ? it->node->data : NULL;
+                    return it->node != NULL ? rb_data (it->node, it->tree) : NULL;
                 }
             }
         }
@@ -109,7 +167,7 @@ void* it_next (struct rbiter* it)
                 it->node = it->node->link[0];
             }
 
-            return it->node->data;
+            return rb_data (it->node, it->tree);
         }
     }
 
@@ -124,6 +182,8 @@ void* it_prev (struct rbiter* it)
 {
     if (it != NULL)
     {
+        rb_stat (it->tree, steps, 1);
+
         if (it->node == NULL)
         {
             return it_end (it, it->tree);
@@ -132,12 +192,12 @@ void* it_prev (struct rbiter* it)
         {
             struct rbnode *q, *p;
 
-            for (p = it->node, q = p->parent; ; p = q, q = q->parent)
+            for (p = it->node, q = rb_parent (p); ; p = q, q = rb_parent (q))
             {
                 if (q == NULL || p == q->link[1])
                 {
                     it->node = q;
-                    return it->node != NULL ? it->node->data : NULL;
+                    return it->node != NULL ? rb_data (it->node, it->tree) : NULL;
                 }
             }
         }
@@ -150,13 +210,150 @@ void* it_prev (struct rbiter* it)
                 it->node = it->node->link[1];
             }
 
-            return it->node->data;
+            return rb_data (it->node, it->tree);
         }
     }
 
     return NULL;
 }
 
+// =========================================================================
+//   CLASS     :
+//   METHOD    : it_erase
+// =========================================================================
+void* it_erase (struct rbiter* it)
+{
+    if (it == NULL || it->node == NULL)
+    {
+        return NULL;
+    }
+
+    // nodes keep their element when the tree is rebalanced, the successor stays valid.
+    struct rbnode* node = it->node;
+    void* next = it_next (it);
+
+    rb_erase (node, it->tree);
+
+    return next;
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : hint_position
+// =========================================================================
+int hint_position (const void* data, struct rbnode* hint, struct rbnode** parent, int* dir, struct rbtree* tree)
+{
+    // equal elements go after the existing ones, like rb_insert does.
+    int multi = (tree->flags & RB_MULTI) != 0;
+    struct rbiter it = { hint, tree };
+    struct rbnode* near;
+    int comp = 1;
+
+    if (hint != NULL && (comp = rb_comp (tree, data, rb_data (hint, tree))) == 0 && !multi)
+    {
+        return -1;
+    }
+
+    // the new element goes between the hint and its neighbour on the side of the element.
+    int side = (comp > 0 || (comp == 0 && multi));
+
+    if (hint == NULL)
+    {
+        near = tree->ends[1];
+    }
+    else
+    {
+        side ? it_next (&it) : it_prev (&it);
+        near = it.node;
+    }
+
+    if (near != NULL)
+    {
+        comp = rb_comp (tree, data, rb_data (near, tree));
+
+        // the element must follow a preceding neighbour, and precede a following one.
+        int ok = (hint == NULL || !side) ? (comp > 0 || (comp == 0 && multi)) : (comp < 0);
+
+        if (!ok)
+        {
+            return (comp == 0 && !multi) ? -1 : 1;
+        }
+    }
+
+    // one of two adjacent nodes has a free slot facing the other.
+    if (hint == NULL)
+    {
+        *parent = near, *dir = 1;
+    }
+    else if (hint->link[side] == NULL)
+    {
+        *parent = hint, *dir = side;
+    }
+    else
+    {
+        *parent = near, *dir = !side;
+    }
+
+    return 0;
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rb_insert_hint
+// =========================================================================
+void* rb_insert_hint (void* data, struct rbiter* hint, struct rbtree* tree)
+{
+    if (tree == NULL)
+    {
+        return NULL;
+    }
+
+    struct rbnode* parent = NULL;
+    struct rbnode* node;
+    int dir = 0, ret = 1;
+
+    if (hint != NULL && hint->tree == tree)
+    {
+        ret = hint_position (data, hint->node, &parent, &dir, tree);
+    }
+
+    if (ret == 1)
+    {
+        // wrong hint, locate the leaf from the root without touching the tree.
+        parent = NULL;
+        node = tree->root;
+
+        while (node != NULL)
+        {
+            int comp = rb_comp (tree, rb_data (node, tree), data);
+
+            if (comp == 0 && !(tree->flags & RB_MULTI))
+            {
+                return NULL;
+            }
+
+            parent = node;
+            dir = comp <= 0;
+            node = node->link[dir];
+        }
+
+        ret = 0;
+    }
+
+    if (ret != 0 || (node = rb_link_data (data, parent, dir, tree)) == NULL)
+    {
+        return NULL;
+    }
+
+    if (hint != NULL)
+    {
+        hint->tree = tree;
+        hint->node = node;
+    }
+
+    return data;
+}
+
 // =========================================================================
 //   CLASS     :
 //   METHOD    : it_cur
@@ -165,7 +362,7 @@ void* it_cur (struct rbiter* it)
 {
     if (it != NULL)
     {
-        return it->node != NULL ? it->node->data : NULL;
+        return it->node != NULL ? rb_data (it->node, it->tree) : NULL;
     }
 
     return NULL;
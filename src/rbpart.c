@@ -0,0 +1,328 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2023 Mathieu Rabine
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// rbtree.
+#include <rbpart.h>
+
+// C.
+#include <stdlib.h>
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : heap_less
+// =========================================================================
+int heap_less (size_t a, size_t b, struct rbpartiter* it)
+{
+    int cmp = it->part->parts[a].tree->comp (it_cur (&it->its[a]), it_cur (&it->its[b]));
+
+    // equal elements come out in partition order.
+    return (cmp < 0) || (cmp == 0 && a < b);
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : heap_down
+// =========================================================================
+void heap_down (size_t i, struct rbpartiter* it)
+{
+    for (;;)
+    {
+        size_t min = i;
+        size_t l = 2 * i + 1, r = 2 * i + 2;
+
+        if (l < it->size && heap_less (it->heap[l], it->heap[min], it))
+        {
+            min = l;
+        }
+
+        if (r < it->size && heap_less (it->heap[r], it->heap[min], it))
+        {
+            min = r;
+        }
+
+        if (min == i)
+        {
+            break;
+        }
+
+        size_t tmp = it->heap[i];
+        it->heap[i] = it->heap[min];
+        it->heap[min] = tmp;
+        i = min;
+    }
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rb_part_new
+// =========================================================================
+struct rbpart* rb_part_new (rb_compare* compare, rb_destroy* destroy, size_t nparts, rb_splitter* split, void* ctx)
+{
+    if (nparts == 0 || split == NULL)
+    {
+        return NULL;
+    }
+
+    struct rbpart* part = malloc (sizeof (struct rbpart));
+
+    if (part != NULL)
+    {
+        part->parts = aligned_alloc (64, nparts * sizeof (struct rbpartition));
+        part->nparts = 0;
+        part->split = split;
+        part->ctx = ctx;
+
+        if (part->parts == NULL)
+        {
+            free (part);
+            return NULL;
+        }
+
+        for (; part->nparts < nparts; ++part->nparts)
+        {
+            struct rbpartition* p = &part->parts[part->nparts];
+
+            p->tree = rb_new (compare, destroy);
+
+            if (p->tree == NULL || pthread_mutex_init (&p->lock, NULL) != 0)
+            {
+                rb_delete (p->tree);
+                rb_part_delete (part);
+                return NULL;
+            }
+        }
+    }
+
+    return part;
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rb_part_delete
+// =========================================================================
+void rb_part_delete (struct rbpart* part)
+{
+    if (part != NULL)
+    {
+        for (size_t i = 0; i < part->nparts; ++i)
+        {
+            rb_delete (part->parts[i].tree);
+            pthread_mutex_destroy (&part->parts[i].lock);
+        }
+
+        free (part->parts);
+        free (part);
+    }
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : part_of
+// =========================================================================
+struct rbpartition* part_of (const void* data, struct rbpart* part)
+{
+    size_t idx = part->split (data, part->nparts, part->ctx);
+
+    // an index out of range comes from a faulty splitter, never index with it.
+    if (idx >= part->nparts)
+    {
+        return NULL;
+    }
+
+    return &part->parts[idx];
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rb_part_insert
+// =========================================================================
+void* rb_part_insert (void* data, struct rbpart* part)
+{
+    struct rbpartition* p = part_of (data, part);
+
+    if (p == NULL)
+    {
+        return NULL;
+    }
+
+    pthread_mutex_lock (&p->lock);
+    void* inserted = rb_insert (data, p->tree);
+    pthread_mutex_unlock (&p->lock);
+
+    return inserted;
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rb_part_find
+// =========================================================================
+void* rb_part_find (const void* data, struct rbpart* part)
+{
+    struct rbpartition* p = part_of (data, part);
+
+    if (p == NULL)
+    {
+        return NULL;
+    }
+
+    pthread_mutex_lock (&p->lock);
+    void* found = rb_find (data, p->tree);
+    pthread_mutex_unlock (&p->lock);
+
+    return found;
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rb_part_remove
+// =========================================================================
+void rb_part_remove (const void* data, struct rbpart* part)
+{
+    struct rbpartition* p = part_of (data, part);
+
+    if (p == NULL)
+    {
+        return;
+    }
+
+    pthread_mutex_lock (&p->lock);
+    rb_remove (data, p->tree);
+    pthread_mutex_unlock (&p->lock);
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rb_part_size
+// =========================================================================
+size_t rb_part_size (struct rbpart* part)
+{
+    size_t count = 0;
+
+    if (part != NULL)
+    {
+        for (size_t i = 0; i < part->nparts; ++i)
+        {
+            count += __atomic_load_n (&part->parts[i].tree->count, __ATOMIC_RELAXED);
+        }
+    }
+
+    return count;
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rb_part_beg
+// =========================================================================
+void* rb_part_beg (struct rbpartiter* it, struct rbpart* part)
+{
+    if (it == NULL || part == NULL)
+    {
+        return NULL;
+    }
+
+    it->part = part;
+    it->its = malloc (part->nparts * sizeof (struct rbiter));
+    it->heap = malloc (part->nparts * sizeof (size_t));
+    it->size = 0;
+
+    if (it->its == NULL || it->heap == NULL)
+    {
+        free (it->its);
+        free (it->heap);
+        it->its = NULL;
+        return NULL;
+    }
+
+    // always lock in partition order, writers only ever hold one lock.
+    for (size_t i = 0; i < part->nparts; ++i)
+    {
+        pthread_mutex_lock (&part->parts[i].lock);
+
+        if (it_beg (&it->its[i], part->parts[i].tree) != NULL)
+        {
+            it->heap[it->size++] = i;
+        }
+    }
+
+    for (size_t i = it->size / 2; i-- > 0;)
+    {
+        heap_down (i, it);
+    }
+
+    if (it->size == 0)
+    {
+        rb_part_release (it);
+        return NULL;
+    }
+
+    return it_cur (&it->its[it->heap[0]]);
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rb_part_next
+// =========================================================================
+void* rb_part_next (struct rbpartiter* it)
+{
+    if (it == NULL || it->its == NULL)
+    {
+        return NULL;
+    }
+
+    if (it_next (&it->its[it->heap[0]]) == NULL)
+    {
+        it->heap[0] = it->heap[--it->size];
+    }
+
+    if (it->size == 0)
+    {
+        rb_part_release (it);
+        return NULL;
+    }
+
+    heap_down (0, it);
+
+    return it_cur (&it->its[it->heap[0]]);
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rb_part_release
+// =========================================================================
+void rb_part_release (struct rbpartiter* it)
+{
+    if (it != NULL && it->its != NULL)
+    {
+        for (size_t i = it->part->nparts; i-- > 0;)
+        {
+            pthread_mutex_unlock (&it->part->parts[i].lock);
+        }
+
+        free (it->its);
+        free (it->heap);
+        it->its = NULL;
+        it->heap = NULL;
+        it->size = 0;
+    }
+}
@@ -0,0 +1,369 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2023 Mathieu Rabine
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// rbtree.
+#include <rbrcu.h>
+
+// C.
+#include <stdlib.h>
+#include <sched.h>
+
+/// maximum number of steps of a lookup, bounds lookups racing with a writer.
+#define RB_RCU_DEPTH 128
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rcu_synchronize
+// =========================================================================
+void rcu_synchronize (struct rbrcu* tree)
+{
+    unsigned long epoch = tree->epoch + 1;
+
+    __atomic_store_n (&tree->epoch, epoch, __ATOMIC_SEQ_CST);
+    __atomic_thread_fence (__ATOMIC_SEQ_CST);
+
+    // wait for readers that entered their read section before the new epoch.
+    for (struct rbreader* reader = tree->readers; reader != NULL; reader = reader->next)
+    {
+        unsigned long cur;
+
+        while ((cur = __atomic_load_n (&reader->epoch, __ATOMIC_ACQUIRE)) != 0 && cur < epoch)
+        {
+            sched_yield ();
+        }
+    }
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rcu_reclaim
+// =========================================================================
+void rcu_reclaim (struct rbrcu* tree)
+{
+    if (tree->nretired > 0)
+    {
+        rcu_synchronize (tree);
+
+        while (tree->nretired > 0)
+        {
+            free (tree->retired[--tree->nretired]);
+        }
+    }
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rcu_alloc
+// =========================================================================
+void* rcu_alloc (size_t size, void* ctx)
+{
+    (void) ctx;
+    return malloc (size);
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rcu_free
+// =========================================================================
+void rcu_free (void* ptr, void* ctx)
+{
+    struct rbrcu* tree = ctx;
+
+    // readers may still walk this node, it is freed after the grace period.
+    if (tree->nretired == tree->cap)
+    {
+        size_t cap = tree->cap ? 2 * tree->cap : 16;
+        void** retired = realloc (tree->retired, cap * sizeof (void*));
+
+        if (retired == NULL)
+        {
+            rcu_synchronize (tree);
+            free (ptr);
+            return;
+        }
+
+        tree->retired = retired;
+        tree->cap = cap;
+    }
+
+    tree->retired[tree->nretired++] = ptr;
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rcu_flip
+// =========================================================================
+void rcu_flip (struct rbrcu* tree)
+{
+    __atomic_store_n (&tree->seq, tree->seq + 1, __ATOMIC_RELEASE);
+    __atomic_thread_fence (__ATOMIC_RELEASE);
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rcu_destroy
+// =========================================================================
+int rcu_destroy (void* data, void* ctx)
+{
+    ((struct rbrcu*)ctx)->del (data);
+    return 0;
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rb_rcu_new
+// =========================================================================
+struct rbrcu* rb_rcu_new (rb_compare* compare, rb_destroy* destroy)
+{
+    struct rbrcu* tree = calloc (1, sizeof (struct rbrcu));
+
+    if (tree != NULL)
+    {
+        struct rballoc alloc = { rcu_alloc, rcu_free, NULL, tree };
+
+        tree->copy[0] = rb_new_ex (compare, NULL, 0, &alloc);
+        tree->copy[1] = rb_new_ex (compare, NULL, 0, &alloc);
+        tree->epoch = 1;
+        tree->del = destroy;
+
+        if (tree->copy[0] == NULL || tree->copy[1] == NULL || pthread_mutex_init (&tree->lock, NULL) != 0)
+        {
+            rb_delete (tree->copy[0]);
+            rb_delete (tree->copy[1]);
+            free (tree);
+            return NULL;
+        }
+    }
+
+    return tree;
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rb_rcu_delete
+// =========================================================================
+void rb_rcu_delete (struct rbrcu* tree)
+{
+    if (tree != NULL)
+    {
+        if (tree->del != NULL)
+        {
+            rb_range (NULL, NULL, rcu_destroy, tree, tree->copy[0]);
+        }
+
+        rb_delete (tree->copy[0]);
+        rb_delete (tree->copy[1]);
+
+        while (tree->nretired > 0)
+        {
+            free (tree->retired[--tree->nretired]);
+        }
+
+        pthread_mutex_destroy (&tree->lock);
+        free (tree->retired);
+        free (tree);
+    }
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rb_rcu_register
+// =========================================================================
+struct rbreader* rb_rcu_register (struct rbrcu* tree)
+{
+    if (tree == NULL)
+    {
+        return NULL;
+    }
+
+    struct rbreader* reader = aligned_alloc (64, sizeof (struct rbreader));
+
+    if (reader != NULL)
+    {
+        reader->epoch = 0;
+        reader->tree = tree;
+
+        pthread_mutex_lock (&tree->lock);
+        reader->next = tree->readers;
+        tree->readers = reader;
+        pthread_mutex_unlock (&tree->lock);
+    }
+
+    return reader;
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rb_rcu_unregister
+// =========================================================================
+void rb_rcu_unregister (struct rbreader* reader)
+{
+    if (reader != NULL)
+    {
+        struct rbrcu* tree = reader->tree;
+
+        pthread_mutex_lock (&tree->lock);
+        for (struct rbreader** cur = &tree->readers; *cur != NULL; cur = &(*cur)->next)
+        {
+            if (*cur == reader)
+            {
+                *cur = reader->next;
+                break;
+            }
+        }
+        pthread_mutex_unlock (&tree->lock);
+
+        free (reader);
+    }
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rb_rcu_read_lock
+// =========================================================================
+void rb_rcu_read_lock (struct rbreader* reader)
+{
+    __atomic_store_n (&reader->epoch, __atomic_load_n (&reader->tree->epoch, __ATOMIC_RELAXED), __ATOMIC_RELAXED);
+    __atomic_thread_fence (__ATOMIC_SEQ_CST);
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rb_rcu_read_unlock
+// =========================================================================
+void rb_rcu_read_unlock (struct rbreader* reader)
+{
+    __atomic_store_n (&reader->epoch, 0, __ATOMIC_RELEASE);
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rb_rcu_find
+// =========================================================================
+void* rb_rcu_find (const void* data, struct rbreader* reader)
+{
+    struct rbrcu* tree = reader->tree;
+
+    for (;;)
+    {
+        unsigned long seq = __atomic_load_n (&tree->seq, __ATOMIC_ACQUIRE);
+        struct rbtree* copy = tree->copy[seq & 1];
+        struct rbnode* node = __atomic_load_n (&copy->root, __ATOMIC_RELAXED);
+        void* found = NULL;
+
+        for (int steps = 0; node != NULL && steps < RB_RCU_DEPTH; ++steps)
+        {
+            void* cur = __atomic_load_n (&((struct rbelem*)node)->data, __ATOMIC_RELAXED);
+            int comp = copy->comp (cur, data);
+
+            if (comp == 0)
+            {
+                found = cur;
+                break;
+            }
+
+            node = __atomic_load_n (&node->link[comp < 0], __ATOMIC_RELAXED);
+        }
+
+        // the copy was not modified during the lookup, the result is consistent.
+        __atomic_thread_fence (__ATOMIC_ACQUIRE);
+        if (__atomic_load_n (&tree->seq, __ATOMIC_RELAXED) == seq)
+        {
+            return found;
+        }
+    }
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rb_rcu_insert
+// =========================================================================
+void* rb_rcu_insert (void* data, struct rbrcu* tree)
+{
+    void* inserted = NULL;
+
+    pthread_mutex_lock (&tree->lock);
+
+    rcu_flip (tree);
+    inserted = rb_insert (data, tree->copy[0]);
+    rcu_flip (tree);
+
+    if (inserted != NULL && rb_insert (data, tree->copy[1]) == NULL)
+    {
+        // out of memory, take the element back out of the first copy.
+        rcu_flip (tree);
+        rb_remove (data, tree->copy[0]);
+        rcu_flip (tree);
+        inserted = NULL;
+    }
+
+    rcu_reclaim (tree);
+
+    pthread_mutex_unlock (&tree->lock);
+
+    return inserted;
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rb_rcu_remove
+// =========================================================================
+void rb_rcu_remove (const void* data, struct rbrcu* tree)
+{
+    pthread_mutex_lock (&tree->lock);
+
+    void* found = rb_find (data, tree->copy[0]);
+
+    if (found != NULL)
+    {
+        rcu_flip (tree);
+        rb_remove (data, tree->copy[0]);
+        rcu_flip (tree);
+        rb_remove (data, tree->copy[1]);
+
+        // nodes and element are released once no reader can see them anymore.
+        rcu_reclaim (tree);
+
+        if (tree->del != NULL)
+        {
+            tree->del (found);
+        }
+    }
+
+    pthread_mutex_unlock (&tree->lock);
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rb_rcu_size
+// =========================================================================
+size_t rb_rcu_size (struct rbrcu* tree)
+{
+    if (tree != NULL)
+    {
+        return __atomic_load_n (&tree->copy[1]->count, __ATOMIC_RELAXED);
+    }
+
+    return 0;
+}
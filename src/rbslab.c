@@ -0,0 +1,160 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2023 Mathieu Rabine
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// rbtree.
+#include <rbslab.h>
+
+// C.
+#include <stdlib.h>
+#include <unistd.h>
+
+/**
+ * @brief slab chunk.
+ */
+struct rbchunk
+{
+    struct rbchunk* next;       // next chunk.
+};
+
+/**
+ * @brief slab context.
+ */
+struct rbslab
+{
+    struct rbchunk* chunks;     // allocated chunks.
+    void*           freelist;   // freed nodes.
+    char*           cur;        // first unused byte of the current chunk.
+    char*           end;        // end of the current chunk.
+    size_t          size;       // node size.
+    size_t          page;       // chunk size.
+};
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : slab_alloc
+// =========================================================================
+void* slab_alloc (size_t size, void* ctx)
+{
+    struct rbslab* slab = ctx;
+    void* node = slab->freelist;
+
+    if (slab->size == 0)
+    {
+        // all nodes of a tree have the same size, keep them pointer aligned.
+        slab->size = (size + sizeof (void*) - 1) & ~(sizeof (void*) - 1);
+    }
+
+    if (size > slab->size)
+    {
+        return NULL;
+    }
+
+    if (node != NULL)
+    {
+        slab->freelist = *(void**)node;
+        return node;
+    }
+
+    if (slab->cur == NULL || (size_t)(slab->end - slab->cur) < slab->size)
+    {
+        struct rbchunk* chunk = malloc (slab->page);
+        if (chunk == NULL)
+        {
+            return NULL;
+        }
+
+        chunk->next = slab->chunks;
+        slab->chunks = chunk;
+        slab->cur = (char*)(chunk + 1);
+        slab->end = (char*)chunk + slab->page;
+
+        if ((size_t)(slab->end - slab->cur) < slab->size)
+        {
+            return NULL;
+        }
+    }
+
+    node = slab->cur;
+    slab->cur += slab->size;
+
+    return node;
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : slab_free
+// =========================================================================
+void slab_free (void* ptr, void* ctx)
+{
+    struct rbslab* slab = ctx;
+
+    *(void**)ptr = slab->freelist;
+    slab->freelist = ptr;
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : slab_release
+// =========================================================================
+void slab_release (void* ctx)
+{
+    struct rbslab* slab = ctx;
+
+    while (slab->chunks != NULL)
+    {
+        struct rbchunk* next = slab->chunks->next;
+        free (slab->chunks);
+        slab->chunks = next;
+    }
+
+    free (slab);
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rb_slab
+// =========================================================================
+int rb_slab (struct rballoc* alloc)
+{
+    if (alloc == NULL)
+    {
+        return -1;
+    }
+
+    struct rbslab* slab = calloc (1, sizeof (struct rbslab));
+    if (slab == NULL)
+    {
+        return -1;
+    }
+
+    long page = sysconf (_SC_PAGESIZE);
+    slab->page = page > 0 ? (size_t)page : 4096;
+
+    alloc->alloc   = slab_alloc;
+    alloc->free    = slab_free;
+    alloc->release = slab_release;
+    alloc->ctx     = slab;
+
+    return 0;
+}
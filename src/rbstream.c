@@ -0,0 +1,262 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2023 Mathieu Rabine
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// rbtree.
+#include <rbstream.h>
+#include <rbiter.h>
+
+// C.
+#include <stdlib.h>
+#include <string.h>
+
+/// stream magic.
+#define RB_STREAM_MAGIC     "RBSTRM\r\n"
+
+/// byte order marker.
+#define RB_STREAM_ORDER     0x01020304
+
+/// size of the stream buffer.
+#define RB_STREAM_BUFFER    (1 << 16)
+
+/**
+ * @brief stream header.
+ */
+struct rbstreamheader
+{
+    char           magic[8];    // "RBSTRM\r\n".
+    uint32_t       version;     // stream format version.
+    uint32_t       order;       // 0x01020304 in the byte order of the writer.
+    uint64_t       count;       // number of elements.
+};
+
+/**
+ * @brief buffered stream input.
+ */
+struct rbstreamin
+{
+    rb_reader*     read;        // input function.
+    void*          ctx;         // input context.
+    rb_deserialize* deserialize;    // element deserialization function.
+    char*          buf;         // buffer.
+    size_t         cap;         // buffer capacity.
+    size_t         pos;         // first unread byte.
+    size_t         len;         // buffered bytes.
+};
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rb_stream_write
+// =========================================================================
+int rb_stream_write (rb_writer* write, void* ctx, rb_serialize* serialize, struct rbtree* tree)
+{
+    if (write == NULL || serialize == NULL || tree == NULL)
+    {
+        return -1;
+    }
+
+    struct rbstreamheader header;
+    memset (&header, 0, sizeof (header));
+    memcpy (header.magic, RB_STREAM_MAGIC, sizeof (header.magic));
+    header.version = RB_STREAM_VERSION;
+    header.order = RB_STREAM_ORDER;
+    header.count = rb_size (tree);
+
+    size_t cap = RB_STREAM_BUFFER, len = sizeof (header);
+    char* buf = malloc (cap);
+
+    if (buf == NULL)
+    {
+        return -1;
+    }
+
+    memcpy (buf, &header, sizeof (header));
+
+    struct rbiter it;
+
+    for (void* data = it_beg (&it, tree); data != NULL; data = it_next (&it))
+    {
+        // serialize in place behind the length, flush or grow the buffer when it does not fit.
+        size_t size = serialize (data, buf + len + 8, cap - len - 8);
+
+        if (size > cap - len - 8)
+        {
+            if (write (buf, len, ctx) != 0)
+            {
+                free (buf);
+                return -1;
+            }
+
+            len = 0;
+
+            if (size > cap - 8)
+            {
+                char* grown = realloc (buf, size + 8);
+
+                if (grown == NULL)
+                {
+                    free (buf);
+                    return -1;
+                }
+
+                buf = grown;
+                cap = size + 8;
+            }
+
+            if (serialize (data, buf + 8, cap - 8) != size)
+            {
+                free (buf);
+                return -1;
+            }
+        }
+
+        uint64_t length = size;
+        memcpy (buf + len, &length, 8);
+        len += 8 + size;
+
+        // keep room for the next length.
+        if (cap - len < 8)
+        {
+            if (write (buf, len, ctx) != 0)
+            {
+                free (buf);
+                return -1;
+            }
+
+            len = 0;
+        }
+    }
+
+    int ret = (len > 0) ? write (buf, len, ctx) : 0;
+
+    free (buf);
+
+    return ret;
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : in_fill
+// =========================================================================
+int in_fill (size_t size, struct rbstreamin* in)
+{
+    if (in->len - in->pos >= size)
+    {
+        return 0;
+    }
+
+    // move the unread bytes to the front, and grow the buffer for records larger than it.
+    memmove (in->buf, in->buf + in->pos, in->len - in->pos);
+    in->len -= in->pos;
+    in->pos = 0;
+
+    if (size > in->cap)
+    {
+        char* buf = realloc (in->buf, size);
+
+        if (buf == NULL)
+        {
+            return -1;
+        }
+
+        in->buf = buf;
+        in->cap = size;
+    }
+
+    while (in->len < size)
+    {
+        size_t n = in->read (in->buf + in->len, in->cap - in->len, in->ctx);
+
+        if (n == 0 || n > in->cap - in->len)
+        {
+            return -1;
+        }
+
+        in->len += n;
+    }
+
+    return 0;
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : in_next
+// =========================================================================
+void* in_next (void* ctx)
+{
+    struct rbstreamin* in = ctx;
+    uint64_t length;
+
+    if (in_fill (8, in) != 0)
+    {
+        return NULL;
+    }
+
+    memcpy (&length, in->buf + in->pos, 8);
+    in->pos += 8;
+
+    if (length > SIZE_MAX / 2 || in_fill ((size_t)length, in) != 0)
+    {
+        return NULL;
+    }
+
+    void* data = in->deserialize (in->buf + in->pos, (size_t)length);
+    in->pos += (size_t)length;
+
+    return data;
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rb_stream_read
+// =========================================================================
+int rb_stream_read (rb_reader* read, void* ctx, rb_deserialize* deserialize, struct rbtree* tree)
+{
+    if (read == NULL || deserialize == NULL || tree == NULL || !rb_empty (tree))
+    {
+        return -1;
+    }
+
+    struct rbstreamin in = {read, ctx, deserialize, malloc (RB_STREAM_BUFFER), RB_STREAM_BUFFER, 0, 0};
+    struct rbstreamheader header;
+    int ret = -1;
+
+    if (in.buf != NULL && in_fill (sizeof (header), &in) == 0)
+    {
+        memcpy (&header, in.buf, sizeof (header));
+        in.pos = sizeof (header);
+
+        if (memcmp (header.magic, RB_STREAM_MAGIC, sizeof (header.magic)) == 0
+            && header.version == RB_STREAM_VERSION && header.order == RB_STREAM_ORDER && header.count <= SIZE_MAX)
+        {
+            if (header.count == 0 || rb_build_source (in_next, &in, (size_t)header.count, tree) == header.count)
+            {
+                ret = 0;
+            }
+        }
+    }
+
+    free (in.buf);
+
+    return ret;
+}
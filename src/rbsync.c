@@ -0,0 +1,337 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2023 Mathieu Rabine
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// rbtree.
+#include <rbsync.h>
+
+// C.
+#include <stdlib.h>
+#include <sched.h>
+
+/// next reader counter to hand out.
+static unsigned int next_shard = 0;
+
+/// reader counter of the calling thread.
+static _Thread_local int thread_shard = -1;
+
+/// read locks held by the calling thread.
+static _Thread_local struct
+{
+    struct rbsync*   sync;      // tree read locked, NULL if the slot is free.
+    unsigned long    depth;     // number of nested read locks.
+} thread_held[RB_SYNC_NESTED];
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : sync_shard
+// =========================================================================
+struct rbshard* sync_shard (struct rbsync* sync)
+{
+    if (thread_shard < 0)
+    {
+        thread_shard = __atomic_fetch_add (&next_shard, 1, __ATOMIC_RELAXED) % RB_SYNC_SHARDS;
+    }
+
+    return &sync->shards[thread_shard];
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : sync_held
+// =========================================================================
+int sync_held (struct rbsync* sync)
+{
+    int slot = -1;
+
+    for (int i = 0; i < RB_SYNC_NESTED; ++i)
+    {
+        if (thread_held[i].sync == sync)
+        {
+            return i;
+        }
+
+        if (slot < 0 && thread_held[i].sync == NULL)
+        {
+            slot = i;
+        }
+    }
+
+    return slot;
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rb_sync_new
+// =========================================================================
+struct rbsync* rb_sync_new (rb_compare* compare, rb_destroy* destroy)
+{
+    struct rbsync* sync = aligned_alloc (64, sizeof (struct rbsync));
+
+    if (sync != NULL)
+    {
+        for (int i = 0; i < RB_SYNC_SHARDS; ++i)
+        {
+            sync->shards[i].readers = 0;
+        }
+
+        sync->writer = 0;
+        sync->tree = rb_new (compare, destroy);
+
+        if (sync->tree == NULL || pthread_mutex_init (&sync->lock, NULL) != 0)
+        {
+            rb_delete (sync->tree);
+            free (sync);
+            return NULL;
+        }
+    }
+
+    return sync;
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rb_sync_delete
+// =========================================================================
+void rb_sync_delete (struct rbsync* sync)
+{
+    if (sync != NULL)
+    {
+        rb_delete (sync->tree);
+        pthread_mutex_destroy (&sync->lock);
+        free (sync);
+    }
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rb_sync_read_lock
+// =========================================================================
+int rb_sync_read_lock (struct rbsync* sync)
+{
+    struct rbshard* shard = sync_shard (sync);
+    int slot = sync_held (sync);
+
+    // an untracked lock could not be re-entered, refuse it rather than risk a deadlock.
+    if (slot < 0)
+    {
+        return -1;
+    }
+
+    // a writer waits for the outer lock of this thread, nested ones must not wait for it.
+    if (thread_held[slot].depth > 0)
+    {
+        ++thread_held[slot].depth;
+        return 0;
+    }
+
+    for (;;)
+    {
+        __atomic_fetch_add (&shard->readers, 1, __ATOMIC_SEQ_CST);
+
+        if (!__atomic_load_n (&sync->writer, __ATOMIC_SEQ_CST))
+        {
+            thread_held[slot].sync = sync;
+            thread_held[slot].depth = 1;
+
+            return 0;
+        }
+
+        // back off while a writer is waiting or running.
+        __atomic_fetch_sub (&shard->readers, 1, __ATOMIC_RELEASE);
+
+        while (__atomic_load_n (&sync->writer, __ATOMIC_RELAXED))
+        {
+            sched_yield ();
+        }
+    }
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rb_sync_read_unlock
+// =========================================================================
+int rb_sync_read_unlock (struct rbsync* sync)
+{
+    int slot = sync_held (sync);
+
+    // the reader counter to decrement is the one of the thread holding the lock.
+    if (slot < 0 || thread_held[slot].sync != sync)
+    {
+        return -1;
+    }
+
+    if (--thread_held[slot].depth > 0)
+    {
+        return 0;
+    }
+
+    thread_held[slot].sync = NULL;
+    __atomic_fetch_sub (&sync_shard (sync)->readers, 1, __ATOMIC_RELEASE);
+
+    return 0;
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rb_sync_write_lock
+// =========================================================================
+void rb_sync_write_lock (struct rbsync* sync)
+{
+    pthread_mutex_lock (&sync->lock);
+
+    __atomic_store_n (&sync->writer, 1, __ATOMIC_SEQ_CST);
+
+    for (int i = 0; i < RB_SYNC_SHARDS; ++i)
+    {
+        while (__atomic_load_n (&sync->shards[i].readers, __ATOMIC_ACQUIRE) != 0)
+        {
+            sched_yield ();
+        }
+    }
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rb_sync_write_unlock
+// =========================================================================
+void rb_sync_write_unlock (struct rbsync* sync)
+{
+    __atomic_store_n (&sync->writer, 0, __ATOMIC_RELEASE);
+    pthread_mutex_unlock (&sync->lock);
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rb_sync_insert
+// =========================================================================
+void* rb_sync_insert (void* data, struct rbsync* sync)
+{
+    rb_sync_write_lock (sync);
+    void* inserted = rb_insert (data, sync->tree);
+    rb_sync_write_unlock (sync);
+
+    return inserted;
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rb_sync_find
+// =========================================================================
+void* rb_sync_find (const void* data, struct rbsync* sync)
+{
+    if (rb_sync_read_lock (sync) != 0)
+    {
+        return NULL;
+    }
+
+    void* found = rb_find (data, sync->tree);
+    rb_sync_read_unlock (sync);
+
+    return found;
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rb_sync_remove
+// =========================================================================
+void rb_sync_remove (const void* data, struct rbsync* sync)
+{
+    rb_sync_write_lock (sync);
+    rb_remove (data, sync->tree);
+    rb_sync_write_unlock (sync);
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rb_sync_size
+// =========================================================================
+size_t rb_sync_size (struct rbsync* sync)
+{
+    if (sync != NULL)
+    {
+        return __atomic_load_n (&sync->tree->count, __ATOMIC_RELAXED);
+    }
+
+    return 0;
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rb_sync_beg
+// =========================================================================
+void* rb_sync_beg (struct rbsynciter* it, struct rbsync* sync)
+{
+    if (it == NULL || sync == NULL)
+    {
+        return NULL;
+    }
+
+    it->sync = sync;
+    it->held = (rb_sync_read_lock (sync) == 0);
+
+    if (!it->held)
+    {
+        return NULL;
+    }
+
+    void* data = it_beg (&it->it, sync->tree);
+    if (data == NULL)
+    {
+        rb_sync_release (it);
+    }
+
+    return data;
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rb_sync_next
+// =========================================================================
+void* rb_sync_next (struct rbsynciter* it)
+{
+    if (it == NULL || !it->held)
+    {
+        return NULL;
+    }
+
+    void* data = it_next (&it->it);
+    if (data == NULL)
+    {
+        rb_sync_release (it);
+    }
+
+    return data;
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rb_sync_release
+// =========================================================================
+void rb_sync_release (struct rbsynciter* it)
+{
+    if (it != NULL && it->held && rb_sync_read_unlock (it->sync) == 0)
+    {
+        it->held = 0;
+    }
+}
@@ -28,6 +28,75 @@
 // C.
 #include <stdlib.h>
 #include <stdio.h>
+#include <pthread.h>
+
+/**
+ * @brief tree node allocated by the tree, with the size of its subtree.
+ */
+struct rbsized
+{
+    struct rbelem  elem;        // node and data.
+    size_t         size;        // number of nodes in the subtree.
+};
+
+#if defined (__GNUC__)
+#define prefetch(addr) __builtin_prefetch (addr)
+#else
+#define prefetch(addr) ((void)(addr))
+#endif
+
+/// number of interleaved descents of batch operations.
+#define RB_BATCH 16
+
+/// set operations.
+#define RB_SET_UNION        0
+#define RB_SET_INTERSECT    1
+#define RB_SET_DIFFERENCE   2
+
+/// maximum recursion depth forking threads in set operations, up to 2^depth threads.
+#define RB_FORK_DEPTH   3
+
+/// minimum black height of a subtree to hand it to another thread.
+#define RB_FORK_HEIGHT  10
+
+/**
+ * @brief state of a set operation.
+ */
+struct rbset
+{
+    int            op;          // set operation.
+    int            depth;       // recursion depth of forked threads.
+    struct rbtree* tree;        // tree receiving the result.
+    struct rbnode* dropped[2];  // nodes left out of the result, of the tree and the other tree.
+    size_t         ndropped[2]; // number of nodes left out.
+};
+
+/**
+ * @brief set operation on a pair of subtrees, run by another thread.
+ */
+struct rbtask
+{
+    struct rbnode* a;           // subtree of the tree.
+    size_t         ah;          // black height of a.
+    struct rbnode* b;           // subtree of the other tree.
+    size_t         bh;          // black height of b.
+    struct rbnode* root;        // result.
+    size_t         height;      // black height of the result.
+    struct rbset   set;         // state of the subtree operation.
+};
+
+/**
+ * @brief state of a build from an element source.
+ */
+struct rbsource
+{
+    rb_source*     next;        // element source.
+    void*          ctx;         // source context.
+    void*          last;        // last element produced.
+    int            err;         // set on failure.
+};
+
+void* set_task (void* arg);
 
 // =========================================================================
 //   CLASS     :
@@ -35,313 +104,2438 @@
 // =========================================================================
 int is_red (struct rbnode* node)
 {
-    return node ? node->red : 0;
+    return node ? rb_red (node) : 0;
 }
 
 // =========================================================================
 //   CLASS     :
-//   METHOD    : make_node
+//   METHOD    : node_size
 // =========================================================================
-struct rbnode* make_node (void* data)
+size_t node_size (struct rbnode* node)
 {
-    struct rbnode* node = malloc (sizeof (struct rbnode));
-
-    if (node != NULL)
-    {
-        node->link[0] = node->link[1] = node->parent = NULL;
-        node->data = data;
-        node->red = 1;
-    }
-
-    return node;
+    return node ? ((struct rbsized*)node)->size : 0;
 }
 
 // =========================================================================
 //   CLASS     :
-//   METHOD    : single_rotate
+//   METHOD    : update_node
 // =========================================================================
-struct rbnode* single_rotate (struct rbnode* node, int dir)
+void update_node (struct rbnode* node, struct rbtree* tree)
 {
-    struct rbnode* save = node->link[!dir];
-
-    if (save != NULL)
+    if (tree->flags & RB_RANK)
     {
-        node->link[!dir] = save->link[dir];
-        if (node->link[!dir] != NULL)
-            node->link[!dir]->parent = node;
-        save->parent = node->parent;
-        save->link[dir] = node;
-        node->parent = save;
-        node->red = 1;
-        save->red = 0;
+        ((struct rbsized*)node)->size = 1 + node_size (node->link[0]) + node_size (node->link[1]);
     }
 
-    return save;
+    if (tree->augment != NULL)
+    {
+        tree->augment (node, tree);
+    }
 }
 
 // =========================================================================
 //   CLASS     :
-//   METHOD    : double_rotate
+//   METHOD    : update_path
 // =========================================================================
-struct rbnode* double_rotate (struct rbnode* node, int dir)
+void update_path (struct rbnode* node, struct rbtree* tree)
 {
-    node->link[!dir] = single_rotate (node->link[!dir], !dir);
-    return single_rotate (node, dir);
+    if ((tree->flags & RB_RANK) || tree->augment != NULL)
+    {
+        while (node != NULL)
+        {
+            update_node (node, tree);
+            node = rb_parent (node);
+        }
+    }
 }
 
 // =========================================================================
 //   CLASS     :
-//   METHOD    : rb_new
+//   METHOD    : link_ends
 // =========================================================================
-struct rbtree* rb_new (rb_compare* compare, rb_destroy* destroy)
+void link_ends (struct rbnode* node, struct rbnode* parent, int dir, struct rbtree* tree)
 {
-    struct rbtree* tree = malloc (sizeof (struct rbtree));
-
-    if (tree != NULL)
+    // a new leaf is the first node only when hung left of the previous first one.
+    if (parent == NULL)
     {
-        tree->comp  = compare;
-        tree->del   = destroy;
-        tree->root  = NULL;
-        tree->count = 0;
+        tree->ends[0] = tree->ends[1] = node;
+    }
+    else if (parent == tree->ends[dir])
+    {
+        tree->ends[dir] = node;
     }
-
-    return tree;
 }
 
 // =========================================================================
 //   CLASS     :
-//   METHOD    : rb_delete
+//   METHOD    : unlink_ends
 // =========================================================================
-void rb_delete (struct rbtree* tree)
+void unlink_ends (struct rbnode* node, struct rbtree* tree)
 {
-    if (tree != NULL)
+    // the first node has no left child, the next one is down its right subtree or its parent.
+    for (int dir = 0; dir < 2; ++dir)
     {
-        struct rbnode* node = tree->root;
-        struct rbnode* save = NULL;
-
-        while (node != NULL)
+        if (node == tree->ends[dir])
         {
-            if (node->link[0] == NULL)
+            struct rbnode* next = node->link[!dir];
+
+            if (next != NULL)
             {
-                save = node->link[1];
-                if (tree->del != NULL && node->data != NULL)
-                    tree->del (node->data);
-                free (node);
-                node = NULL;
+                while (next->link[dir] != NULL)
+                    next = next->link[dir];
             }
             else
             {
-                save = node->link[0];
-                node->link[0] = save->link[1];
-                save->link[1] = node;
+                next = rb_parent (node);
             }
 
-            node = save;
+            tree->ends[dir] = next;
         }
-
-        free (tree);
     }
 }
 
 // =========================================================================
 //   CLASS     :
-//   METHOD    : rb_insert
+//   METHOD    : set_root
 // =========================================================================
-void* rb_insert (void* data, struct rbtree* tree)
+void set_root (struct rbnode* root, struct rbtree* tree)
 {
-    void* inserted = NULL;
+    tree->root = root;
+    tree->ends[0] = tree->ends[1] = root;
 
-    if (tree->root == NULL)
+    if (root != NULL)
     {
-        tree->root = make_node (data);
-        if (tree->root == NULL)
-        {
-            return NULL;
-        }
+        root->parent_color = 0;
 
-        inserted = tree->root->data;
-        ++tree->count;
+        while (tree->ends[0]->link[0] != NULL)
+            tree->ends[0] = tree->ends[0]->link[0];
+        while (tree->ends[1]->link[1] != NULL)
+            tree->ends[1] = tree->ends[1]->link[1];
     }
-    else
-    {
-        struct rbnode head = { 0 };
-        struct rbnode *g, *t;
-        struct rbnode *p, *q;
-        int dir = 0, last, comp;
+}
 
-        t = &head;
-        g = p = NULL;
-        q = t->link[1] = tree->root;
+// =========================================================================
+//   CLASS     :
+//   METHOD    : std_alloc
+// =========================================================================
+void* std_alloc (size_t size, void* ctx)
+{
+    (void) ctx;
+    return malloc (size);
+}
 
-        for (;;)
-        {
-            if (q == NULL)
-            {
-                p->link[dir] = q = make_node (data);
-                if (q == NULL)
-                {
-                    return NULL;
-                }
-                q->parent = p;
-                inserted = q->data;
-                ++tree->count;
-            }
-            else if (is_red (q->link[0]) && is_red (q->link[1]))
-            {
-                q->red = 1;
-                q->link[0]->red = q->link[1]->red = 0;
-            }
+// =========================================================================
+//   CLASS     :
+//   METHOD    : std_free
+// =========================================================================
+void std_free (void* ptr, void* ctx)
+{
+    (void) ctx;
+    free (ptr);
+}
 
-            if (is_red (q) && is_red (p))
-            {
-                int dir2 = t->link[1] == g;
+// =========================================================================
+//   CLASS     :
+//   METHOD    : value_offset
+// =========================================================================
+size_t value_offset (struct rbtree* tree)
+{
+    // the value of a map node follows the fields of the node.
+    return (tree->flags & RB_RANK) ? sizeof (struct rbsized) : sizeof (struct rbelem);
+}
 
-                if (q == p->link[last])
-                {
-                    t->link[dir2] = single_rotate (g, !last);
-                }
-                else
-                {
-                    t->link[dir2] = double_rotate (g, !last);
-                }
-            }
+// =========================================================================
+//   CLASS     :
+//   METHOD    : make_node
+// =========================================================================
+struct rbnode* make_node (void* data, struct rbtree* tree)
+{
+    struct rbnode* node;
 
-            if (inserted != NULL || (comp = tree->comp (q->data, data)) == 0)
-            {
-                break;
-            }
+    if (tree->flags & RB_INTRUSIVE)
+    {
+        node = data;
+    }
+    else
+    {
+        node = tree->alloc.alloc (value_offset (tree) + ((tree->flags & RB_MAP) ? sizeof (void*) : 0), tree->alloc.ctx);
+        rb_stat (tree, allocs, node != NULL);
+    }
 
-            last = dir;
-            dir = comp < 0;
+    if (node != NULL)
+    {
+        node->link[0] = node->link[1] = NULL;
+        node->parent_color = 1;
 
-            if (g != NULL)
-            {
-                t = g;
-            }
+        if (!(tree->flags & RB_INTRUSIVE))
+        {
+            ((struct rbelem*)node)->data = data;
+        }
 
-            g = p, p = q;
-            q = q->link[dir];
+        if (tree->flags & RB_RANK)
+        {
+            ((struct rbsized*)node)->size = 1;
         }
 
-        tree->root = head.link[1];
+        if (tree->flags & RB_MAP)
+        {
+            *rb_value (node, tree) = NULL;
+        }
     }
 
-    tree->root->red = 0;
+    return node;
+}
 
-    return inserted;
+// =========================================================================
+//   CLASS     :
+//   METHOD    : free_node
+// =========================================================================
+void free_node (struct rbnode* node, struct rbtree* tree)
+{
+    // nodes go back to the allocator even when it can release them all at once, so it can recycle them.
+    if (!(tree->flags & RB_INTRUSIVE))
+    {
+        tree->alloc.free (node, tree->alloc.ctx);
+        rb_stat (tree, frees, 1);
+    }
 }
 
 // =========================================================================
 //   CLASS     :
-//   METHOD    : rb_find
+//   METHOD    : destroy_data
 // =========================================================================
-void* rb_find (const void* data, struct rbtree* tree)
+void destroy_data (void* data, void* value, struct rbtree* tree)
 {
-    if (tree != NULL)
+    if (tree->del != NULL && data != NULL)
     {
-        struct rbnode* node = tree->root;
-        int comp;
+        tree->del (data);
+    }
 
-        while (node != NULL)
-        {
-            if ((comp = tree->comp (node->data, data)) == 0)
-                return node->data;
-            node = node->link[comp < 0];
-        }
+    if (tree->vdel != NULL && value != NULL)
+    {
+        tree->vdel (value);
     }
+}
 
-    return NULL;
+// =========================================================================
+//   CLASS     :
+//   METHOD    : drop_node
+// =========================================================================
+void drop_node (struct rbnode* node, struct rbtree* tree)
+{
+    void* data = rb_data (node, tree);
+    void* value = (tree->flags & RB_MAP) ? *rb_value (node, tree) : NULL;
+
+    free_node (node, tree);
+    destroy_data (data, value, tree);
 }
 
 // =========================================================================
 //   CLASS     :
-//   METHOD    : rb_remove
+//   METHOD    : rotate_uncounted
 // =========================================================================
-void rb_remove (const void* data, struct rbtree* tree)
+struct rbnode* rotate_uncounted (struct rbnode* node, int dir, struct rbtree* tree)
 {
-    if (tree->root != NULL)
+    struct rbnode* save = node->link[!dir];
+
+    // joins run in the threads of set operations, counters are only updated by single_rotate.
+    if (save != NULL)
     {
-        struct rbnode head = { 0 };
-        struct rbnode *q, *p, *g;
-        struct rbnode *f = NULL;
-        int dir = 1;
+        node->link[!dir] = save->link[dir];
+        if (node->link[!dir] != NULL)
+            rb_set_parent (node->link[!dir], node);
+        save->parent_color = (uintptr_t)rb_parent (node);
+        save->link[dir] = node;
+        node->parent_color = (uintptr_t)save | 1;
+        update_node (node, tree);
+        update_node (save, tree);
+    }
 
-        q = &head;
-        g = p = NULL;
-        q->link[1] = tree->root;
+    return save;
+}
 
-        while (q->link[dir] != NULL)
-        {
-            int last = dir;
+// =========================================================================
+//   CLASS     :
+//   METHOD    : single_rotate
+// =========================================================================
+struct rbnode* single_rotate (struct rbnode* node, int dir, struct rbtree* tree)
+{
+    rb_stat (tree, rotations, node->link[!dir] != NULL);
 
-            g = p, p = q;
-            q = q->link[dir];
+    return rotate_uncounted (node, dir, tree);
+}
 
-            int comp = tree->comp (q->data, data);
-            dir = comp < 0;
+// =========================================================================
+//   CLASS     :
+//   METHOD    : double_rotate
+// =========================================================================
+struct rbnode* double_rotate (struct rbnode* node, int dir, struct rbtree* tree)
+{
+    node->link[!dir] = single_rotate (node->link[!dir], !dir, tree);
+    return single_rotate (node, dir, tree);
+}
 
-            if (comp == 0)
-            {
-                f = q;
-            }
+// =========================================================================
+//   CLASS     :
+//   METHOD    : replace_child
+// =========================================================================
+void replace_child (struct rbnode* parent, struct rbnode* node, struct rbnode* child, struct rbtree* tree)
+{
+    if (parent != NULL)
+        parent->link[parent->link[1] == node] = child;
+    else
+        tree->root = child;
+}
 
-            if (!is_red (q) && !is_red (q->link[dir]))
-            {
-                if (is_red (q->link[!dir]))
-                {
-                    p = p->link[last] = single_rotate (q, dir);
-                }
-                else if (!is_red (q->link[!dir]))
-                {
-                    struct rbnode* s = p->link[!last];
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rotate
+// =========================================================================
+void rotate (struct rbnode* node, int dir, struct rbtree* tree)
+{
+    struct rbnode* save = node->link[!dir];
+    struct rbnode* parent = rb_parent (node);
 
-                    if (s != NULL)
-                    {
-                        if (!is_red (s->link[!last]) && !is_red (s->link[last]))
-                        {
-                            p->red = 0;
-                            s->red = 1;
-                            q->red = 1;
-                        }
-                        else
-                        {
-                            int dir2 = g->link[1] == p;
+    rb_stat (tree, rotations, 1);
+    node->link[!dir] = save->link[dir];
+    if (node->link[!dir] != NULL)
+        rb_set_parent (node->link[!dir], node);
+    save->link[dir] = node;
+    rb_set_parent (save, parent);
+    rb_set_parent (node, save);
+    replace_child (parent, node, save, tree);
+    update_node (node, tree);
+    update_node (save, tree);
+}
 
-                            if (is_red (s->link[last]))
-                            {
-                                g->link[dir2] = double_rotate (p, last);
-                            }
-                            else if (is_red (s->link[!last]))
-                            {
-                                g->link[dir2] = single_rotate (p, last);
-                            }
+// =========================================================================
+//   CLASS     :
+//   METHOD    : insert_fixup
+// =========================================================================
+void insert_fixup (struct rbnode* node, struct rbtree* tree)
+{
+    struct rbnode* p;
 
-                            q->red = g->link[dir2]->red = 1;
-                            g->link[dir2]->link[0]->red = 0;
-                            g->link[dir2]->link[1]->red = 0;
-                        }
-                    }
-                }
+    while ((p = rb_parent (node)) != NULL && rb_red (p))
+    {
+        struct rbnode* g = rb_parent (p);
+        int dir = g->link[1] == p;
+        struct rbnode* u = g->link[!dir];
+
+        if (is_red (u))
+        {
+            rb_stat (tree, recolors, 1);
+            rb_set_red (p, 0);
+            rb_set_red (u, 0);
+            rb_set_red (g, 1);
+            node = g;
+            continue;
+        }
+
+        if (p->link[!dir] == node)
+        {
+            rotate (p, dir, tree);
+            node = p;
+            p = rb_parent (node);
+        }
+
+        rb_set_red (p, 0);
+        rb_set_red (g, 1);
+        rotate (g, !dir, tree);
+    }
+
+    rb_set_red (tree->root, 0);
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : remove_fixup
+// =========================================================================
+void remove_fixup (struct rbnode* node, struct rbnode* parent, struct rbtree* tree)
+{
+    while (node != tree->root && !is_red (node))
+    {
+        int dir = parent->link[1] == node;
+        struct rbnode* s = parent->link[!dir];
+
+        if (rb_red (s))
+        {
+            rb_set_red (s, 0);
+            rb_set_red (parent, 1);
+            rotate (parent, dir, tree);
+            s = parent->link[!dir];
+        }
+
+        if (!is_red (s->link[0]) && !is_red (s->link[1]))
+        {
+            rb_stat (tree, recolors, 1);
+            rb_set_red (s, 1);
+            node = parent;
+            parent = rb_parent (node);
+        }
+        else
+        {
+            if (!is_red (s->link[!dir]))
+            {
+                rb_set_red (s->link[dir], 0);
+                rb_set_red (s, 1);
+                rotate (s, !dir, tree);
+                s = parent->link[!dir];
             }
+
+            rb_set_red (s, rb_red (parent));
+            rb_set_red (parent, 0);
+            rb_set_red (s->link[!dir], 0);
+            rotate (parent, dir, tree);
+            node = tree->root;
         }
+    }
 
-        if (f != NULL)
+    if (node != NULL)
+    {
+        rb_set_red (node, 0);
+    }
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rb_new
+// =========================================================================
+struct rbtree* rb_new (rb_compare* compare, rb_destroy* destroy)
+{
+    return rb_new_ex (compare, destroy, 0, NULL);
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rb_new_ex
+// =========================================================================
+struct rbtree* rb_new_ex (rb_compare* compare, rb_destroy* destroy, int flags, const struct rballoc* alloc)
+{
+    if (alloc != NULL && (alloc->alloc == NULL || alloc->free == NULL))
+    {
+        return NULL;
+    }
+
+    if ((flags & (RB_RANK | RB_MAP)) && (flags & RB_INTRUSIVE))
+    {
+        return NULL;
+    }
+
+    struct rbtree* tree = malloc (sizeof (struct rbtree));
+
+    if (tree != NULL)
+    {
+        tree->comp  = compare;
+        tree->del   = destroy;
+        tree->vdel  = NULL;
+        tree->root  = NULL;
+        tree->ends[0] = tree->ends[1] = NULL;
+        tree->count = 0;
+        tree->flags = flags;
+        tree->augment = NULL;
+        rb_stats_reset (tree);
+
+        if (alloc != NULL)
         {
-            if (tree->del != NULL && f->data != NULL)
-                tree->del (f->data);
-            f->data = q->data;
-            p->link[p->link[1] == q] = q->link[q->link[0] == NULL];
-            --tree->count;
-            free (q);
+            tree->alloc = *alloc;
+        }
+        else
+        {
+            tree->alloc.alloc   = std_alloc;
+            tree->alloc.free    = std_free;
+            tree->alloc.release = NULL;
+            tree->alloc.ctx     = NULL;
+        }
+    }
+
+    return tree;
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rb_set_augment
+// =========================================================================
+int rb_set_augment (rb_propagate* propagate, struct rbtree* tree)
+{
+    if (tree == NULL || tree->root != NULL)
+    {
+        return -1;
+    }
+
+    tree->augment = propagate;
+
+    return 0;
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rb_set_value_destroy
+// =========================================================================
+int rb_set_value_destroy (rb_destroy* destroy, struct rbtree* tree)
+{
+    if (tree == NULL || !(tree->flags & RB_MAP))
+    {
+        return -1;
+    }
+
+    tree->vdel = destroy;
+
+    return 0;
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rb_value
+// =========================================================================
+void** rb_value (struct rbnode* node, struct rbtree* tree)
+{
+    return (void**)((char*)node + value_offset (tree));
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rb_delete
+// =========================================================================
+void rb_delete (struct rbtree* tree)
+{
+    if (tree != NULL)
+    {
+        struct rbnode* node = tree->root;
+        struct rbnode* save = NULL;
+
+        // nodes are released at once or not owned at all, only walk the tree if data must be deleted.
+        if ((tree->alloc.release != NULL || (tree->flags & RB_INTRUSIVE)) && tree->del == NULL && tree->vdel == NULL)
+        {
+            node = NULL;
+        }
+
+        while (node != NULL)
+        {
+            if (node->link[0] == NULL)
+            {
+                save = node->link[1];
+
+                // released nodes are not freed one by one, only their data is destroyed.
+                if (tree->alloc.release != NULL)
+                    destroy_data (rb_data (node, tree), (tree->flags & RB_MAP) ? *rb_value (node, tree) : NULL, tree);
+                else
+                    drop_node (node, tree);
+
+                node = NULL;
+            }
+            else
+            {
+                save = node->link[0];
+                node->link[0] = save->link[1];
+                save->link[1] = node;
+            }
+
+            node = save;
+        }
+
+        if (tree->alloc.release != NULL)
+        {
+            tree->alloc.release (tree->alloc.ctx);
+        }
+
+        free (tree);
+    }
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : insert_top_down
+// =========================================================================
+struct rbnode* insert_top_down (void* data, int* inserted, struct rbtree* tree)
+{
+    struct rbnode* node = NULL;
+
+    *inserted = 0;
+
+    if (tree->root == NULL)
+    {
+        tree->root = node = make_node (data, tree);
+        if (tree->root == NULL)
+        {
+            return NULL;
+        }
+
+        link_ends (node, NULL, 0, tree);
+        update_node (tree->root, tree);
+        *inserted = 1;
+        ++tree->count;
+    }
+    else
+    {
+        struct rbnode head = { 0 };
+        struct rbnode *g, *t;
+        struct rbnode *p, *q;
+        int dir = 0, last, comp;
+        size_t depth = 0;
+
+        t = &head;
+        g = p = NULL;
+        q = t->link[1] = tree->root;
+
+        for (;;)
+        {
+            if (q == NULL)
+            {
+                p->link[dir] = q = make_node (data, tree);
+                if (q == NULL)
+                {
+                    // rotations may already have moved the root, leave through the common exit.
+                    break;
+                }
+                rb_set_parent (q, p);
+                link_ends (q, p, dir, tree);
+                update_path (q, tree);
+                *inserted = 1;
+                ++tree->count;
+            }
+            else if (is_red (q->link[0]) && is_red (q->link[1]))
+            {
+                rb_stat (tree, recolors, 1);
+                rb_set_red (q, 1);
+                rb_set_red (q->link[0], 0);
+                rb_set_red (q->link[1], 0);
+            }
+
+            if (is_red (q) && is_red (p))
+            {
+                int dir2 = t->link[1] == g;
+
+                if (q == p->link[last])
+                {
+                    t->link[dir2] = single_rotate (g, !last, tree);
+                }
+                else
+                {
+                    t->link[dir2] = double_rotate (g, !last, tree);
+                }
+            }
+
+            // rotations above never move q, it is the node holding the element.
+            if (*inserted || ((comp = rb_comp (tree, rb_data (q, tree), data)) == 0 && !(tree->flags & RB_MULTI)))
+            {
+                node = q;
+                break;
+            }
+
+            ++depth;
+
+            // equal elements go after the existing ones to keep insertion order.
+            last = dir;
+            dir = comp <= 0;
+
+            if (g != NULL)
+            {
+                t = g;
+            }
+
+            g = p, p = q;
+            q = q->link[dir];
         }
 
         tree->root = head.link[1];
+        rb_stat_depth (tree, depth);
+    }
 
-        if (tree->root != NULL)
+    rb_set_red (tree->root, 0);
+
+    return node;
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : insert_bottom_up
+// =========================================================================
+struct rbnode* insert_bottom_up (void* data, int* inserted, struct rbtree* tree)
+{
+    struct rbnode* parent = NULL;
+    struct rbnode* node = tree->root;
+    int dir = 0;
+    size_t depth = 0;
+
+    *inserted = 0;
+
+    // descend without writing anything, the fix-up climbs only as far as colors require.
+    while (node != NULL)
+    {
+        // load both children while the element is compared, the top-down pass gets that from reading colors.
+        prefetch (node->link[0]);
+        prefetch (node->link[1]);
+
+        int comp = rb_comp (tree, rb_data (node, tree), data);
+
+        if (comp == 0 && !(tree->flags & RB_MULTI))
         {
-            tree->root->red = 0;
+            break;
         }
+
+        ++depth;
+
+        // equal elements go after the existing ones to keep insertion order.
+        parent = node;
+        dir = comp <= 0;
+        node = node->link[dir];
+    }
+
+    if (tree->root != NULL)
+    {
+        rb_stat_depth (tree, depth);
+    }
+
+    if (node != NULL)
+    {
+        return node;
+    }
+
+    node = make_node (data, tree);
+    if (node != NULL)
+    {
+        rb_link (node, parent, dir, tree);
+        *inserted = 1;
+    }
+
+    return node;
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : insert_node
+// =========================================================================
+struct rbnode* insert_node (void* data, int* inserted, struct rbtree* tree)
+{
+    if (tree->flags & RB_TOPDOWN)
+    {
+        return insert_top_down (data, inserted, tree);
+    }
+
+    return insert_bottom_up (data, inserted, tree);
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rb_insert
+// =========================================================================
+void* rb_insert (void* data, struct rbtree* tree)
+{
+    int inserted;
+
+    return (insert_node (data, &inserted, tree) != NULL && inserted) ? data : NULL;
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : free_nodes
+// =========================================================================
+void free_nodes (struct rbnode* node, struct rbtree* tree)
+{
+    if (node != NULL && !(tree->flags & RB_INTRUSIVE))
+    {
+        free_nodes (node->link[0], tree);
+        free_nodes (node->link[1], tree);
+        tree->alloc.free (node, tree->alloc.ctx);
+    }
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : build_nodes
+// =========================================================================
+struct rbnode* build_nodes (void** items, size_t n, size_t depth, size_t full, struct rbtree* tree, int* err)
+{
+    if (n == 0)
+    {
+        return NULL;
+    }
+
+    size_t mid = n / 2;
+
+    struct rbnode* left = build_nodes (items, mid, depth + 1, full, tree, err);
+    if (*err)
+    {
+        return NULL;
+    }
+
+    struct rbnode* node = make_node (items[mid], tree);
+    if (node == NULL)
+    {
+        free_nodes (left, tree);
+        *err = 1;
+        return NULL;
+    }
+
+    struct rbnode* right = build_nodes (items + mid + 1, n - mid - 1, depth + 1, full, tree, err);
+    if (*err)
+    {
+        free_nodes (left, tree);
+        free_nodes (node, tree);
+        return NULL;
+    }
+
+    // all levels above the last one are complete, only nodes of an incomplete last level are red.
+    rb_set_red (node, depth >= full);
+
+    node->link[0] = left;
+    if (left != NULL)
+        rb_set_parent (left, node);
+    node->link[1] = right;
+    if (right != NULL)
+        rb_set_parent (right, node);
+    update_node (node, tree);
+
+    return node;
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rb_build_sorted
+// =========================================================================
+size_t rb_build_sorted (void** items, size_t n, struct rbtree* tree)
+{
+    if (tree == NULL || tree->root != NULL || items == NULL || n == 0)
+    {
+        return 0;
+    }
+
+    size_t count = 1, full = 0;
+    int err = 0;
+
+    // check the order before touching items, unsorted input leaves them as they were.
+    for (size_t i = 1; i < n; ++i)
+    {
+        int comp = rb_comp (tree, items[i - 1], items[i]);
+
+        if (comp > 0)
+        {
+            return 0;
+        }
+
+        count += (comp < 0 || (tree->flags & RB_MULTI));
+    }
+
+    // then move rejected equal neighbours after the kept elements.
+    if (count < n)
+    {
+        count = 1;
+
+        for (size_t i = 1; i < n; ++i)
+        {
+            if (rb_comp (tree, items[count - 1], items[i]) < 0)
+            {
+                void* save = items[count];
+                items[count++] = items[i];
+                items[i] = save;
+            }
+        }
+    }
+
+    while (((size_t)2 << full) - 1 <= count)
+    {
+        ++full;
+    }
+
+    set_root (build_nodes (items, count, 0, full, tree, &err), tree);
+    if (err)
+    {
+        return 0;
+    }
+
+    tree->count = count;
+
+    return count;
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rb_build
+// =========================================================================
+size_t rb_build (void** items, size_t n, struct rbtree* tree)
+{
+    if (tree == NULL || tree->root != NULL || items == NULL || n == 0)
+    {
+        return 0;
+    }
+
+    void** tmp = malloc (n * sizeof (void*));
+    if (tmp == NULL)
+    {
+        return 0;
+    }
+
+    void** src = items;
+    void** dst = tmp;
+
+    // bottom-up merge sort, stable so that the first of equal elements wins.
+    for (size_t width = 1; width < n; width *= 2)
+    {
+        for (size_t lo = 0; lo < n; lo += 2 * width)
+        {
+            size_t mid = (lo + width < n) ? lo + width : n;
+            size_t hi = (lo + 2 * width < n) ? lo + 2 * width : n;
+            size_t i = lo, j = mid, k = lo;
+
+            while (i < mid && j < hi)
+            {
+                dst[k++] = (rb_comp (tree, src[j], src[i]) < 0) ? src[j++] : src[i++];
+            }
+
+            while (i < mid)
+            {
+                dst[k++] = src[i++];
+            }
+
+            while (j < hi)
+            {
+                dst[k++] = src[j++];
+            }
+        }
+
+        void** save = src;
+        src = dst;
+        dst = save;
+    }
+
+    if (src != items)
+    {
+        for (size_t i = 0; i < n; ++i)
+        {
+            items[i] = src[i];
+        }
+    }
+
+    free (tmp);
+
+    return rb_build_sorted (items, n, tree);
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : drop_nodes
+// =========================================================================
+void drop_nodes (struct rbnode* node, struct rbtree* tree)
+{
+    if (node != NULL)
+    {
+        drop_nodes (node->link[0], tree);
+        drop_nodes (node->link[1], tree);
+        drop_node (node, tree);
+    }
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : source_nodes
+// =========================================================================
+struct rbnode* source_nodes (size_t n, size_t depth, size_t full, struct rbsource* src, struct rbtree* tree)
+{
+    if (n == 0)
+    {
+        return NULL;
+    }
+
+    size_t mid = n / 2;
+
+    // the left subtree consumes the first elements, then this node, then the right subtree.
+    struct rbnode* left = source_nodes (mid, depth + 1, full, src, tree);
+    if (src->err)
+    {
+        return NULL;
+    }
+
+    void* data = src->next (src->ctx);
+    struct rbnode* node = NULL;
+
+    if (data != NULL && (src->last == NULL || rb_comp (tree, src->last, data) < !!(tree->flags & RB_MULTI)))
+    {
+        node = make_node (data, tree);
+    }
+
+    if (node == NULL)
+    {
+        if (data != NULL && tree->del != NULL)
+        {
+            tree->del (data);
+        }
+
+        drop_nodes (left, tree);
+        src->err = 1;
+        return NULL;
+    }
+
+    src->last = data;
+
+    struct rbnode* right = source_nodes (n - mid - 1, depth + 1, full, src, tree);
+    if (src->err)
+    {
+        drop_nodes (left, tree);
+        drop_node (node, tree);
+        return NULL;
+    }
+
+    rb_set_red (node, depth >= full);
+
+    node->link[0] = left;
+    if (left != NULL)
+        rb_set_parent (left, node);
+    node->link[1] = right;
+    if (right != NULL)
+        rb_set_parent (right, node);
+    update_node (node, tree);
+
+    return node;
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rb_build_source
+// =========================================================================
+size_t rb_build_source (rb_source* next, void* ctx, size_t n, struct rbtree* tree)
+{
+    if (tree == NULL || tree->root != NULL || next == NULL || n == 0)
+    {
+        return 0;
+    }
+
+    struct rbsource src = {next, ctx, NULL, 0};
+    size_t full = 0;
+
+    while (((size_t)2 << full) - 1 <= n)
+    {
+        ++full;
+    }
+
+    set_root (source_nodes (n, 0, full, &src, tree), tree);
+    if (src.err)
+    {
+        return 0;
+    }
+
+    tree->count = n;
+
+    return n;
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : find_node
+// =========================================================================
+struct rbnode* find_node (const void* data, struct rbtree* tree)
+{
+    struct rbnode* found = NULL;
+
+    if (tree != NULL)
+    {
+        struct rbnode* node = tree->root;
+        size_t depth = 0;
+        int comp;
+
+        while (node != NULL)
+        {
+            ++depth;
+            if ((comp = rb_comp (tree, rb_data (node, tree), data)) == 0)
+            {
+                found = node;
+
+                // keep looking for the first of equal elements.
+                if (!(tree->flags & RB_MULTI))
+                    break;
+            }
+            node = node->link[comp < 0];
+        }
+
+        rb_stat_depth (tree, depth);
+    }
+
+    return found;
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rb_find
+// =========================================================================
+void* rb_find (const void* data, struct rbtree* tree)
+{
+    struct rbnode* node = find_node (data, tree);
+
+    return (node != NULL) ? rb_data (node, tree) : NULL;
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : bound_node
+// =========================================================================
+struct rbnode* bound_node (const void* data, int upper, struct rbtree* tree)
+{
+    struct rbnode* node = tree->root;
+    struct rbnode* bound = NULL;
+
+    while (node != NULL)
+    {
+        int comp = rb_comp (tree, rb_data (node, tree), data);
+
+        if (comp < 0 || (upper && comp == 0))
+        {
+            node = node->link[1];
+        }
+        else
+        {
+            bound = node;
+            node = node->link[0];
+        }
+    }
+
+    return bound;
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : next_node
+// =========================================================================
+struct rbnode* next_node (struct rbnode* node)
+{
+    if (node->link[1] != NULL)
+    {
+        node = node->link[1];
+
+        while (node->link[0] != NULL)
+        {
+            node = node->link[0];
+        }
+
+        return node;
+    }
+
+    struct rbnode* parent = rb_parent (node);
+
+    while (parent != NULL && node == parent->link[1])
+    {
+        node = parent;
+        parent = rb_parent (node);
+    }
+
+    return parent;
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rb_lower_bound
+// =========================================================================
+void* rb_lower_bound (const void* data, struct rbtree* tree)
+{
+    if (tree != NULL)
+    {
+        struct rbnode* node = bound_node (data, 0, tree);
+        return node != NULL ? rb_data (node, tree) : NULL;
+    }
+
+    return NULL;
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rb_upper_bound
+// =========================================================================
+void* rb_upper_bound (const void* data, struct rbtree* tree)
+{
+    if (tree != NULL)
+    {
+        struct rbnode* node = bound_node (data, 1, tree);
+        return node != NULL ? rb_data (node, tree) : NULL;
+    }
+
+    return NULL;
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rb_range
+// =========================================================================
+size_t rb_range (const void* lo, const void* hi, rb_visit* visit, void* ctx, struct rbtree* tree)
+{
+    size_t count = 0;
+
+    if (tree != NULL && visit != NULL)
+    {
+        struct rbnode* node = tree->root;
+
+        if (lo != NULL)
+        {
+            node = bound_node (lo, 0, tree);
+        }
+        else
+        {
+            while (node != NULL && node->link[0] != NULL)
+            {
+                node = node->link[0];
+            }
+        }
+
+        while (node != NULL)
+        {
+            void* data = rb_data (node, tree);
+
+            if (hi != NULL && rb_comp (tree, data, hi) >= 0)
+            {
+                break;
+            }
+
+            ++count;
+
+            if (visit (data, ctx) != 0)
+            {
+                break;
+            }
+
+            node = next_node (node);
+        }
+    }
+
+    return count;
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rb_find_batch
+// =========================================================================
+size_t rb_find_batch (const void** keys, void** found, size_t n, struct rbtree* tree)
+{
+    size_t count = 0;
+
+    if (tree == NULL || keys == NULL || found == NULL)
+    {
+        return 0;
+    }
+
+    for (size_t base = 0; base < n; base += RB_BATCH)
+    {
+        struct rbnode* cur[RB_BATCH];
+        size_t depth[RB_BATCH];
+        size_t size = (n - base < RB_BATCH) ? n - base : RB_BATCH;
+        size_t active = size;
+
+        for (size_t i = 0; i < size; ++i)
+        {
+            cur[i] = tree->root;
+            depth[i] = 0;
+            found[base + i] = NULL;
+            prefetch (keys[base + i]);
+        }
+
+        while (active > 0)
+        {
+            // the nodes were prefetched on the previous round, now prefetch the data they hold.
+            if (!(tree->flags & RB_INTRUSIVE))
+            {
+                for (size_t i = 0; i < size; ++i)
+                {
+                    if (cur[i] != NULL)
+                        prefetch (((struct rbelem*)cur[i])->data);
+                }
+            }
+
+            active = 0;
+
+            for (size_t i = 0; i < size; ++i)
+            {
+                if (cur[i] != NULL)
+                {
+                    void* data = rb_data (cur[i], tree);
+                    int comp = rb_comp (tree, data, keys[base + i]);
+
+                    ++depth[i];
+
+                    if (comp == 0)
+                    {
+                        count += (found[base + i] == NULL);
+                        found[base + i] = data;
+
+                        // keep looking for the first of equal elements, like find_node.
+                        cur[i] = (tree->flags & RB_MULTI) ? cur[i]->link[0] : NULL;
+                    }
+                    else
+                    {
+                        cur[i] = cur[i]->link[comp < 0];
+                    }
+
+                    if (cur[i] != NULL)
+                    {
+                        prefetch (cur[i]);
+                        ++active;
+                    }
+                }
+            }
+        }
+
+        // every lane is done, account for each descent like find_node.
+        for (size_t i = 0; i < size; ++i)
+        {
+            rb_stat_depth (tree, depth[i]);
+        }
+    }
+
+    return count;
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rb_insert_batch
+// =========================================================================
+size_t rb_insert_batch (void** items, void** inserted, size_t n, struct rbtree* tree)
+{
+    size_t count = 0;
+
+    if (tree == NULL || items == NULL)
+    {
+        return 0;
+    }
+
+    // insertions rebalance the tree, bottom-up by default and on the way down for RB_TOPDOWN
+    // trees, either way they reshape it and cannot be interleaved.
+    for (size_t i = 0; i < n; ++i)
+    {
+        if (i + 1 < n)
+            prefetch (items[i + 1]);
+
+        void* data = rb_insert (items[i], tree);
+        if (inserted != NULL)
+            inserted[i] = data;
+        count += (data != NULL);
+    }
+
+    return count;
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rb_remove_batch
+// =========================================================================
+size_t rb_remove_batch (const void** keys, size_t n, struct rbtree* tree)
+{
+    if (tree == NULL || keys == NULL)
+    {
+        return 0;
+    }
+
+    size_t count = tree->count;
+
+    for (size_t i = 0; i < n; ++i)
+    {
+        if (i + 1 < n)
+            prefetch (keys[i + 1]);
+
+        rb_remove (keys[i], tree);
+    }
+
+    return count - tree->count;
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : detach_top_down
+// =========================================================================
+struct rbnode* detach_top_down (const void* data, struct rbtree* tree)
+{
+    struct rbnode *f = NULL;
+
+    if (tree->root != NULL)
+    {
+        struct rbnode head = { 0 };
+        struct rbnode *q, *p, *g;
+        int dir = 1;
+        size_t depth = 0;
+
+        q = &head;
+        g = p = NULL;
+        q->link[1] = tree->root;
+
+        while (q->link[dir] != NULL)
+        {
+            int last = dir;
+
+            g = p, p = q;
+            q = q->link[dir];
+
+            int comp = rb_comp (tree, rb_data (q, tree), data);
+            dir = comp < 0;
+            ++depth;
+
+            if (comp == 0)
+            {
+                f = q;
+            }
+
+            if (!is_red (q) && !is_red (q->link[dir]))
+            {
+                if (is_red (q->link[!dir]))
+                {
+                    p = p->link[last] = single_rotate (q, dir, tree);
+                }
+                else if (!is_red (q->link[!dir]))
+                {
+                    struct rbnode* s = p->link[!last];
+
+                    if (s != NULL)
+                    {
+                        if (!is_red (s->link[!last]) && !is_red (s->link[last]))
+                        {
+                            rb_stat (tree, recolors, 1);
+                            rb_set_red (p, 0);
+                            rb_set_red (s, 1);
+                            rb_set_red (q, 1);
+                        }
+                        else
+                        {
+                            int dir2 = g->link[1] == p;
+
+                            if (is_red (s->link[last]))
+                            {
+                                g->link[dir2] = double_rotate (p, last, tree);
+                            }
+                            else if (is_red (s->link[!last]))
+                            {
+                                g->link[dir2] = single_rotate (p, last, tree);
+                            }
+
+                            rb_stat (tree, recolors, 1);
+                            rb_set_red (q, 1);
+                            rb_set_red (g->link[dir2], 1);
+                            rb_set_red (g->link[dir2]->link[0], 0);
+                            rb_set_red (g->link[dir2]->link[1], 0);
+                        }
+                    }
+                }
+            }
+        }
+
+        if (f != NULL)
+        {
+            struct rbnode* c = q->link[q->link[0] == NULL];
+
+            unlink_ends (f, tree);
+
+            // unlink q, it has at most one child.
+            p->link[p->link[1] == q] = c;
+            if (c != NULL)
+                rb_set_parent (c, (p != &head) ? p : NULL);
+
+            // then move q in place of the node found so that nodes never change of element.
+            if (q != f)
+            {
+                q->link[0] = f->link[0];
+                q->link[1] = f->link[1];
+                q->parent_color = f->parent_color;
+
+                if (q->link[0] != NULL)
+                    rb_set_parent (q->link[0], q);
+                if (q->link[1] != NULL)
+                    rb_set_parent (q->link[1], q);
+
+                if (rb_parent (q) != NULL)
+                    rb_parent (q)->link[rb_parent (q)->link[1] == f] = q;
+                else
+                    head.link[1] = q;
+            }
+
+            if (p != &head)
+                update_path ((p != f) ? p : q, tree);
+
+            --tree->count;
+        }
+
+        tree->root = head.link[1];
+        rb_stat_depth (tree, depth);
+
+        if (tree->root != NULL)
+        {
+            rb_set_red (tree->root, 0);
+        }
+    }
+
+    return f;
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : detach_node
+// =========================================================================
+struct rbnode* detach_node (const void* data, struct rbtree* tree)
+{
+    if (tree->flags & RB_TOPDOWN)
+    {
+        return detach_top_down (data, tree);
+    }
+
+    struct rbnode* node = find_node (data, tree);
+
+    if (node != NULL)
+    {
+        rb_unlink (node, tree);
+    }
+
+    return node;
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rb_remove
+// =========================================================================
+void rb_remove (const void* data, struct rbtree* tree)
+{
+    struct rbnode* node = detach_node (data, tree);
+
+    if (node != NULL)
+    {
+        drop_node (node, tree);
+    }
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rb_put
+// =========================================================================
+void* rb_put (void* key, void* value, struct rbtree* tree)
+{
+    if (tree == NULL || !(tree->flags & RB_MAP))
+    {
+        return NULL;
+    }
+
+    int inserted;
+    struct rbnode* node = insert_node (key, &inserted, tree);
+
+    if (node == NULL)
+    {
+        return NULL;
+    }
+
+    void** slot = rb_value (node, tree);
+
+    if (!inserted && tree->vdel != NULL && *slot != NULL && *slot != value)
+    {
+        tree->vdel (*slot);
+    }
+
+    *slot = value;
+
+    return rb_data (node, tree);
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rb_get
+// =========================================================================
+void* rb_get (const void* key, struct rbtree* tree)
+{
+    if (tree == NULL || !(tree->flags & RB_MAP))
+    {
+        return NULL;
+    }
+
+    struct rbnode* node = find_node (key, tree);
+
+    return (node != NULL) ? *rb_value (node, tree) : NULL;
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rb_get_or_insert
+// =========================================================================
+void** rb_get_or_insert (void* key, int* inserted, struct rbtree* tree)
+{
+    if (tree == NULL || !(tree->flags & RB_MAP))
+    {
+        return NULL;
+    }
+
+    int dummy;
+    struct rbnode* node = insert_node (key, (inserted != NULL) ? inserted : &dummy, tree);
+
+    return (node != NULL) ? rb_value (node, tree) : NULL;
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rb_take
+// =========================================================================
+void* rb_take (const void* key, void** value, struct rbtree* tree)
+{
+    if (tree == NULL || !(tree->flags & RB_MAP))
+    {
+        return NULL;
+    }
+
+    struct rbnode* node = detach_node (key, tree);
+
+    if (node == NULL)
+    {
+        return NULL;
+    }
+
+    void* data = rb_data (node, tree);
+
+    if (value != NULL)
+    {
+        *value = *rb_value (node, tree);
+    }
+
+    // the caller gets both the key and the value back, neither is destroyed.
+    free_node (node, tree);
+
+    return data;
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rb_link
+// =========================================================================
+void rb_link (struct rbnode* node, struct rbnode* parent, int dir, struct rbtree* tree)
+{
+    node->link[0] = node->link[1] = NULL;
+    node->parent_color = (uintptr_t)parent | 1;
+
+    if (parent != NULL)
+        parent->link[dir] = node;
+    else
+        tree->root = node;
+
+    link_ends (node, parent, dir, tree);
+    ++tree->count;
+    update_path (node, tree);
+    insert_fixup (node, tree);
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rb_link_data
+// =========================================================================
+struct rbnode* rb_link_data (void* data, struct rbnode* parent, int dir, struct rbtree* tree)
+{
+    struct rbnode* node = make_node (data, tree);
+
+    if (node != NULL)
+    {
+        rb_link (node, parent, dir, tree);
+    }
+
+    return node;
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rb_unlink
+// =========================================================================
+void rb_unlink (struct rbnode* node, struct rbtree* tree)
+{
+    struct rbnode *child, *parent;
+    int red;
+
+    unlink_ends (node, tree);
+
+    if (node->link[0] != NULL && node->link[1] != NULL)
+    {
+        struct rbnode* next = node->link[1];
+
+        while (next->link[0] != NULL)
+        {
+            next = next->link[0];
+        }
+
+        // move the successor in place of the node.
+        child = next->link[1];
+        parent = rb_parent (next);
+        red = rb_red (next);
+
+        if (parent == node)
+        {
+            parent = next;
+        }
+        else
+        {
+            parent->link[0] = child;
+            if (child != NULL)
+                rb_set_parent (child, parent);
+            next->link[1] = node->link[1];
+            rb_set_parent (next->link[1], next);
+        }
+
+        next->link[0] = node->link[0];
+        rb_set_parent (next->link[0], next);
+        next->parent_color = node->parent_color;
+        replace_child (rb_parent (node), node, next, tree);
+    }
+    else
+    {
+        child = node->link[node->link[0] == NULL];
+        parent = rb_parent (node);
+        red = rb_red (node);
+
+        if (child != NULL)
+            rb_set_parent (child, parent);
+        replace_child (parent, node, child, tree);
+    }
+
+    --tree->count;
+    update_path (parent, tree);
+
+    if (!red)
+    {
+        remove_fixup (child, parent, tree);
+    }
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rb_erase
+// =========================================================================
+void rb_erase (struct rbnode* node, struct rbtree* tree)
+{
+    if (node != NULL && tree != NULL)
+    {
+        rb_unlink (node, tree);
+        drop_node (node, tree);
+    }
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : black_height
+// =========================================================================
+size_t black_height (struct rbnode* node)
+{
+    size_t height = 0;
+
+    for (; node != NULL; node = node->link[0])
+    {
+        height += !rb_red (node);
+    }
+
+    return height;
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : join_side
+// =========================================================================
+struct rbnode* join_side (struct rbnode* node, size_t height, struct rbnode* key, struct rbnode* other, size_t other_height, int dir, struct rbtree* tree)
+{
+    // descend the dir spine of the taller tree down to a black node of the same black height.
+    if (!is_red (node) && height == other_height)
+    {
+        key->link[!dir] = node;
+        key->link[dir] = other;
+        key->parent_color = 1;
+        if (node != NULL)
+            rb_set_parent (node, key);
+        if (other != NULL)
+            rb_set_parent (other, key);
+        update_node (key, tree);
+
+        return key;
+    }
+
+    struct rbnode* child = join_side (node->link[dir], height - !rb_red (node), key, other, other_height, dir, tree);
+
+    node->link[dir] = child;
+    rb_set_parent (child, node);
+
+    // a black node above two reds on its dir spine rotates the first red up.
+    if (!rb_red (node) && rb_red (child) && is_red (child->link[dir]))
+    {
+        rb_set_red (child->link[dir], 0);
+        node = rotate_uncounted (node, !dir, tree);
+        rb_set_red (node, 1);
+        rb_set_red (node->link[!dir], 0);
+
+        return node;
+    }
+
+    update_node (node, tree);
+
+    return node;
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : join_nodes
+// =========================================================================
+struct rbnode* join_nodes (struct rbnode* left, size_t lh, struct rbnode* key, struct rbnode* right, size_t rh, size_t* height, struct rbtree* tree)
+{
+    struct rbnode* root;
+
+    if (is_red (left))
+    {
+        rb_set_red (left, 0);
+        ++lh;
+    }
+
+    if (is_red (right))
+    {
+        rb_set_red (right, 0);
+        ++rh;
+    }
+
+    // hang the shorter tree on the facing spine of the taller one, equal trees meet under a red key.
+    if (lh >= rh)
+    {
+        root = join_side (left, lh, key, right, rh, 1, tree);
+        *height = lh;
+    }
+    else
+    {
+        root = join_side (right, rh, key, left, lh, 0, tree);
+        *height = rh;
+    }
+
+    rb_set_parent (root, NULL);
+
+    return root;
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : split_nodes
+// =========================================================================
+struct rbnode* split_nodes (struct rbnode* node, size_t height, const void* data, struct rbnode** left, size_t* lh, struct rbnode** right, size_t* rh, struct rbtree* tree)
+{
+    if (node == NULL)
+    {
+        *left = *right = NULL;
+        *lh = *rh = 0;
+        return NULL;
+    }
+
+    size_t ch = height - !rb_red (node);
+    int comp = tree->comp (rb_data (node, tree), data);
+    struct rbnode *found, *rest;
+    size_t rest_height;
+
+    // equal elements of RB_MULTI trees all go left, like lower elements.
+    if (comp == 0 && !(tree->flags & RB_MULTI))
+    {
+        *left = node->link[0];
+        *right = node->link[1];
+        *lh = *rh = ch;
+        found = node;
+    }
+    else if (comp > 0)
+    {
+        found = split_nodes (node->link[0], ch, data, left, lh, &rest, &rest_height, tree);
+        *right = join_nodes (rest, rest_height, node, node->link[1], ch, rh, tree);
+    }
+    else
+    {
+        found = split_nodes (node->link[1], ch, data, &rest, &rest_height, right, rh, tree);
+        *left = join_nodes (node->link[0], ch, node, rest, rest_height, lh, tree);
+    }
+
+    return found;
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : split_last
+// =========================================================================
+struct rbnode* split_last (struct rbnode* node, size_t height, struct rbnode** rest, size_t* rest_height, struct rbtree* tree)
+{
+    size_t ch = height - !rb_red (node);
+
+    if (node->link[1] == NULL)
+    {
+        *rest = node->link[0];
+        *rest_height = ch;
+        return node;
+    }
+
+    struct rbnode* sub;
+    size_t sub_height;
+    struct rbnode* last = split_last (node->link[1], ch, &sub, &sub_height, tree);
+
+    *rest = join_nodes (node->link[0], ch, node, sub, sub_height, rest_height, tree);
+
+    return last;
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : concat_nodes
+// =========================================================================
+struct rbnode* concat_nodes (struct rbnode* left, size_t lh, struct rbnode* right, size_t rh, size_t* height, struct rbtree* tree)
+{
+    if (left == NULL)
+    {
+        *height = rh;
+        return right;
+    }
+
+    struct rbnode* rest;
+    size_t rest_height;
+    struct rbnode* key = split_last (left, lh, &rest, &rest_height, tree);
+
+    return join_nodes (rest, rest_height, key, right, rh, height, tree);
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : count_nodes
+// =========================================================================
+size_t count_nodes (struct rbnode* node)
+{
+    return node ? 1 + count_nodes (node->link[0]) + count_nodes (node->link[1]) : 0;
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : chain_node
+// =========================================================================
+void chain_node (struct rbnode* node, struct rbnode** list, size_t* count)
+{
+    // dropped nodes are chained through their left link and deleted once all threads are done.
+    node->link[0] = *list;
+    *list = node;
+    ++*count;
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : chain_nodes
+// =========================================================================
+void chain_nodes (struct rbnode* node, struct rbnode** list, size_t* count)
+{
+    if (node != NULL)
+    {
+        struct rbnode* right = node->link[1];
+
+        chain_nodes (node->link[0], list, count);
+        chain_node (node, list, count);
+        chain_nodes (right, list, count);
+    }
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : set_nodes
+// =========================================================================
+struct rbnode* set_nodes (struct rbnode* a, size_t ah, struct rbnode* b, size_t bh, size_t* height, struct rbset* set)
+{
+    if (a == NULL || b == NULL)
+    {
+        if (set->op == RB_SET_UNION || (set->op == RB_SET_DIFFERENCE && b == NULL))
+        {
+            *height = (a != NULL) ? ah : bh;
+            return (a != NULL) ? a : b;
+        }
+
+        chain_nodes (a, &set->dropped[0], &set->ndropped[0]);
+        chain_nodes (b, &set->dropped[1], &set->ndropped[1]);
+        *height = 0;
+        return NULL;
+    }
+
+    size_t ch = bh - !rb_red (b);
+    struct rbnode *l1, *r1, *l2 = b->link[0], *r2 = b->link[1];
+    size_t l1h, r1h, tlh, trh;
+    struct rbnode* found = split_nodes (a, ah, rb_data (b, set->tree), &l1, &l1h, &r1, &r1h, set->tree);
+    struct rbnode *tl, *tr;
+
+    // large subtrees are handed to another thread while this one runs the left side.
+    struct rbtask task = {r1, r1h, r2, ch, NULL, 0, *set};
+    pthread_t thread;
+    int forked = 0;
+
+    task.set.dropped[0] = task.set.dropped[1] = NULL;
+    task.set.ndropped[0] = task.set.ndropped[1] = 0;
+    ++task.set.depth;
+
+    if (set->depth < RB_FORK_DEPTH && ch >= RB_FORK_HEIGHT)
+    {
+        forked = pthread_create (&thread, NULL, set_task, &task) == 0;
+    }
+
+    if (!forked)
+    {
+        task.root = set_nodes (r1, r1h, r2, ch, &task.height, &task.set);
+    }
+
+    ++set->depth;
+    tl = set_nodes (l1, l1h, l2, ch, &tlh, set);
+    --set->depth;
+
+    if (forked)
+    {
+        pthread_join (thread, NULL);
+    }
+
+    tr = task.root;
+    trh = task.height;
+
+    for (int i = 0; i < 2; ++i)
+    {
+        // splice the dropped nodes of the right side in front of this side.
+        for (struct rbnode* node = task.set.dropped[i]; node != NULL;)
+        {
+            struct rbnode* next = node->link[0];
+            chain_node (node, &set->dropped[i], &set->ndropped[i]);
+            node = next;
+        }
+    }
+
+    if (set->op == RB_SET_UNION)
+    {
+        if (found != NULL)
+        {
+            chain_node (b, &set->dropped[1], &set->ndropped[1]);
+            b = found;
+        }
+
+        return join_nodes (tl, tlh, b, tr, trh, height, set->tree);
+    }
+
+    chain_node (b, &set->dropped[1], &set->ndropped[1]);
+
+    if (set->op == RB_SET_INTERSECT && found != NULL)
+    {
+        return join_nodes (tl, tlh, found, tr, trh, height, set->tree);
+    }
+
+    if (found != NULL)
+    {
+        chain_node (found, &set->dropped[0], &set->ndropped[0]);
+    }
+
+    return concat_nodes (tl, tlh, tr, trh, height, set->tree);
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : set_task
+// =========================================================================
+void* set_task (void* arg)
+{
+    struct rbtask* task = arg;
+
+    task->root = set_nodes (task->a, task->ah, task->b, task->bh, &task->height, &task->set);
+
+    return NULL;
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : join_compatible
+// =========================================================================
+int join_compatible (struct rbtree* other, struct rbtree* tree)
+{
+    // nodes move between trees, they must come from the same allocator and never be pooled.
+    return other != NULL && tree != NULL && other != tree && other->comp == tree->comp &&
+        (other->flags & ~RB_TOPDOWN) == (tree->flags & ~RB_TOPDOWN) && other->augment == tree->augment &&
+        other->alloc.alloc == tree->alloc.alloc && other->alloc.free == tree->alloc.free &&
+        other->alloc.ctx == tree->alloc.ctx && other->alloc.release == NULL && tree->alloc.release == NULL;
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rb_join
+// =========================================================================
+int rb_join (struct rbtree* right, struct rbtree* tree)
+{
+    if (!join_compatible (right, tree))
+    {
+        return -1;
+    }
+
+    if (right->root != NULL && tree->root != NULL)
+    {
+        struct rbnode* last = tree->root;
+        struct rbnode* first = right->root;
+
+        while (last->link[1] != NULL)
+            last = last->link[1];
+        while (first->link[0] != NULL)
+            first = first->link[0];
+
+        if (tree->comp (rb_data (last, tree), rb_data (first, tree)) >= !!(tree->flags & RB_MULTI))
+        {
+            return -1;
+        }
+
+        struct rbnode* rest;
+        size_t rest_height, height;
+        struct rbnode* key = split_last (tree->root, black_height (tree->root), &rest, &rest_height, tree);
+
+        set_root (join_nodes (rest, rest_height, key, right->root, black_height (right->root), &height, tree), tree);
+    }
+    else if (tree->root == NULL)
+    {
+        set_root (right->root, tree);
+    }
+
+    tree->count += right->count;
+    set_root (NULL, right);
+    right->count = 0;
+
+    return 0;
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rb_split
+// =========================================================================
+int rb_split (const void* data, struct rbtree* right, struct rbtree* tree)
+{
+    if (!join_compatible (right, tree) || right->root != NULL)
+    {
+        return -1;
+    }
+
+    if (tree->root != NULL)
+    {
+        struct rbnode *left, *rest;
+        size_t lh, rest_height;
+        struct rbnode* found = split_nodes (tree->root, black_height (tree->root), data, &left, &lh, &rest, &rest_height, tree);
+
+        // the element equal to data stays on the left.
+        if (found != NULL)
+        {
+            left = join_nodes (left, lh, found, NULL, 0, &lh, tree);
+        }
+
+        set_root (left, tree);
+        set_root (rest, right);
+
+        right->count = (tree->flags & RB_RANK) ? node_size (rest) : count_nodes (rest);
+        tree->count -= right->count;
+    }
+
+    return 0;
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : set_operation
+// =========================================================================
+int set_operation (int op, struct rbtree* other, struct rbtree* tree)
+{
+    if (!join_compatible (other, tree) || (tree->flags & RB_MULTI))
+    {
+        return -1;
+    }
+
+    struct rbset set = {op, 0, tree, {NULL, NULL}, {0, 0}};
+    size_t height;
+    struct rbtree* owners[2] = {tree, other};
+
+    set_root (set_nodes (tree->root, black_height (tree->root), other->root, black_height (other->root), &height, &set), tree);
+
+    tree->count += other->count - set.ndropped[0] - set.ndropped[1];
+    set_root (NULL, other);
+    other->count = 0;
+
+    for (int i = 0; i < 2; ++i)
+    {
+        while (set.dropped[i] != NULL)
+        {
+            struct rbnode* next = set.dropped[i]->link[0];
+            drop_node (set.dropped[i], owners[i]);
+            set.dropped[i] = next;
+        }
+    }
+
+    return 0;
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rb_union
+// =========================================================================
+int rb_union (struct rbtree* other, struct rbtree* tree)
+{
+    return set_operation (RB_SET_UNION, other, tree);
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rb_intersect
+// =========================================================================
+int rb_intersect (struct rbtree* other, struct rbtree* tree)
+{
+    return set_operation (RB_SET_INTERSECT, other, tree);
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rb_difference
+// =========================================================================
+int rb_difference (struct rbtree* other, struct rbtree* tree)
+{
+    return set_operation (RB_SET_DIFFERENCE, other, tree);
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rb_select
+// =========================================================================
+void* rb_select (size_t k, struct rbtree* tree)
+{
+    if (tree == NULL || k >= tree->count)
+    {
+        return NULL;
+    }
+
+    struct rbnode* node = tree->root;
+
+    if (!(tree->flags & RB_RANK))
+    {
+        while (node->link[0] != NULL)
+        {
+            node = node->link[0];
+        }
+
+        while (k-- > 0)
+        {
+            node = next_node (node);
+        }
+
+        return rb_data (node, tree);
+    }
+
+    for (;;)
+    {
+        size_t left = node_size (node->link[0]);
+
+        if (k == left)
+        {
+            return rb_data (node, tree);
+        }
+
+        if (k < left)
+        {
+            node = node->link[0];
+        }
+        else
+        {
+            k -= left + 1;
+            node = node->link[1];
+        }
+    }
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rb_rank
+// =========================================================================
+size_t rb_rank (const void* data, struct rbtree* tree)
+{
+    size_t rank = 0;
+
+    if (tree == NULL)
+    {
+        return 0;
+    }
+
+    struct rbnode* node = tree->root;
+
+    if (!(tree->flags & RB_RANK))
+    {
+        while (node != NULL && node->link[0] != NULL)
+        {
+            node = node->link[0];
+        }
+
+        while (node != NULL && rb_comp (tree, rb_data (node, tree), data) < 0)
+        {
+            node = next_node (node);
+            ++rank;
+        }
+
+        return rank;
+    }
+
+    while (node != NULL)
+    {
+        if (rb_comp (tree, rb_data (node, tree), data) < 0)
+        {
+            rank += node_size (node->link[0]) + 1;
+            node = node->link[1];
+        }
+        else
+        {
+            node = node->link[0];
+        }
+    }
+
+    return rank;
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rb_count_key
+// =========================================================================
+size_t rb_count_key (const void* data, struct rbtree* tree)
+{
+    if (tree == NULL)
+    {
+        return 0;
+    }
+
+    struct rbnode* node = tree->root;
+    size_t count = 0;
+
+    if (!(tree->flags & RB_RANK))
+    {
+        for (node = bound_node (data, 0, tree); node != NULL && rb_comp (tree, rb_data (node, tree), data) == 0; node = next_node (node))
+        {
+            ++count;
+        }
+
+        return count;
+    }
+
+    // descend to where the equal elements split, then add the ones of each side.
+    while (node != NULL)
+    {
+        int comp = rb_comp (tree, rb_data (node, tree), data);
+
+        if (comp == 0)
+        {
+            break;
+        }
+
+        node = node->link[comp < 0];
+    }
+
+    if (node == NULL)
+    {
+        return 0;
+    }
+
+    count = 1;
+
+    for (struct rbnode* left = node->link[0]; left != NULL;)
+    {
+        if (rb_comp (tree, rb_data (left, tree), data) < 0)
+        {
+            left = left->link[1];
+        }
+        else
+        {
+            count += node_size (left->link[1]) + 1;
+            left = left->link[0];
+        }
+    }
+
+    for (struct rbnode* right = node->link[1]; right != NULL;)
+    {
+        if (rb_comp (tree, rb_data (right, tree), data) > 0)
+        {
+            right = right->link[0];
+        }
+        else
+        {
+            count += node_size (right->link[0]) + 1;
+            right = right->link[1];
+        }
+    }
+
+    return count;
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rb_first
+// =========================================================================
+void* rb_first (struct rbtree* tree)
+{
+    return (tree != NULL && tree->ends[0] != NULL) ? rb_data (tree->ends[0], tree) : NULL;
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rb_last
+// =========================================================================
+void* rb_last (struct rbtree* tree)
+{
+    return (tree != NULL && tree->ends[1] != NULL) ? rb_data (tree->ends[1], tree) : NULL;
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : pop_end
+// =========================================================================
+void* pop_end (int dir, struct rbtree* tree)
+{
+    if (tree == NULL || tree->ends[dir] == NULL)
+    {
+        return NULL;
+    }
+
+    struct rbnode* node = tree->ends[dir];
+    void* data = rb_data (node, tree);
+
+    rb_unlink (node, tree);
+    free_node (node, tree);
+
+    return data;
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rb_pop_first
+// =========================================================================
+void* rb_pop_first (struct rbtree* tree)
+{
+    return pop_end (0, tree);
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rb_pop_last
+// =========================================================================
+void* rb_pop_last (struct rbtree* tree)
+{
+    return pop_end (1, tree);
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rb_stats
+// =========================================================================
+int rb_stats (struct rbtree* tree, struct rbstats* out)
+{
+#ifdef RB_STATS
+    if (tree != NULL && out != NULL)
+    {
+        *out = tree->stats;
+        return 0;
+    }
+#else
+    (void) tree;
+#endif
+
+    if (out != NULL)
+    {
+        *out = (struct rbstats){ 0 };
+    }
+
+    return -1;
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rb_stats_reset
+// =========================================================================
+void rb_stats_reset (struct rbtree* tree)
+{
+#ifdef RB_STATS
+    if (tree != NULL)
+    {
+        tree->stats = (struct rbstats){ 0 };
     }
+#else
+    (void) tree;
+#endif
 }
 
 // =========================================================================
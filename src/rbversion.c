@@ -0,0 +1,632 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2023 Mathieu Rabine
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// rbtree.
+#include <rbversion.h>
+
+// C.
+#include <stdlib.h>
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : vnode_red
+// =========================================================================
+int vnode_red (const struct rbvnode* node)
+{
+    return node != NULL && node->red;
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : vnode_black
+// =========================================================================
+int vnode_black (const struct rbvnode* node)
+{
+    return node != NULL && !node->red;
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : vnode_ref
+// =========================================================================
+struct rbvnode* vnode_ref (struct rbvnode* node)
+{
+    if (node != NULL)
+    {
+        __atomic_fetch_add (&node->refs, 1, __ATOMIC_RELAXED);
+    }
+
+    return node;
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : vnode_unref
+// =========================================================================
+void vnode_unref (struct rbvnode* node)
+{
+    while (node != NULL && __atomic_sub_fetch (&node->refs, 1, __ATOMIC_ACQ_REL) == 0)
+    {
+        struct rbvnode* right = node->link[1];
+
+        vnode_unref (node->link[0]);
+        free (node);
+        node = right;
+    }
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : vnode_make
+// =========================================================================
+struct rbvnode* vnode_make (int red, struct rbvnode* left, void* data, struct rbvnode* right, struct rbvstore* store)
+{
+    // updates reserve their nodes up front, so that they never fail half way.
+    struct rbvnode* node = store->spare;
+
+    store->spare = node->link[0];
+    --store->nspare;
+
+    node->link[0] = left;
+    node->link[1] = right;
+    node->data = data;
+    node->refs = 1;
+    node->red = red;
+
+    return node;
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : vnode_open
+// =========================================================================
+void* vnode_open (struct rbvnode* node, struct rbvnode** left, struct rbvnode** right, struct rbvstore* store)
+{
+    void* data = node->data;
+
+    *left = node->link[0];
+    *right = node->link[1];
+
+    // a node only held by the caller is recycled, a shared one stays in place for older versions.
+    if (__atomic_load_n (&node->refs, __ATOMIC_ACQUIRE) == 1)
+    {
+        node->link[0] = store->spare;
+        store->spare = node;
+        ++store->nspare;
+    }
+    else
+    {
+        vnode_ref (*left);
+        vnode_ref (*right);
+        vnode_unref (node);
+    }
+
+    return data;
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : vnode_paint
+// =========================================================================
+struct rbvnode* vnode_paint (struct rbvnode* node, int red, struct rbvstore* store)
+{
+    if (node == NULL || node->red == red)
+    {
+        return node;
+    }
+
+    struct rbvnode *left, *right;
+    void* data = vnode_open (node, &left, &right, store);
+
+    return vnode_make (red, left, data, right, store);
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : vnode_balance
+// =========================================================================
+struct rbvnode* vnode_balance (struct rbvnode* a, void* x, struct rbvnode* b, struct rbvstore* store)
+{
+    struct rbvnode *l, *m, *r, *s;
+    void *y, *z;
+
+    // a black node above a red-red pair becomes a red node with two black children.
+    if (vnode_red (a) && vnode_red (b))
+    {
+        return vnode_make (1, vnode_paint (a, 0, store), x, vnode_paint (b, 0, store), store);
+    }
+
+    if (vnode_red (a) && vnode_red (a->link[0]))
+    {
+        y = vnode_open (a, &s, &r, store);
+        z = vnode_open (s, &l, &m, store);
+        return vnode_make (1, vnode_make (0, l, z, m, store), y, vnode_make (0, r, x, b, store), store);
+    }
+
+    if (vnode_red (a) && vnode_red (a->link[1]))
+    {
+        y = vnode_open (a, &l, &s, store);
+        z = vnode_open (s, &m, &r, store);
+        return vnode_make (1, vnode_make (0, l, y, m, store), z, vnode_make (0, r, x, b, store), store);
+    }
+
+    if (vnode_red (b) && vnode_red (b->link[1]))
+    {
+        y = vnode_open (b, &l, &s, store);
+        z = vnode_open (s, &m, &r, store);
+        return vnode_make (1, vnode_make (0, a, x, l, store), y, vnode_make (0, m, z, r, store), store);
+    }
+
+    if (vnode_red (b) && vnode_red (b->link[0]))
+    {
+        y = vnode_open (b, &s, &r, store);
+        z = vnode_open (s, &l, &m, store);
+        return vnode_make (1, vnode_make (0, a, x, l, store), z, vnode_make (0, m, y, r, store), store);
+    }
+
+    return vnode_make (0, a, x, b, store);
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : vnode_insert
+// =========================================================================
+struct rbvnode* vnode_insert (struct rbvnode* node, void* data, struct rbvstore* store)
+{
+    if (node == NULL)
+    {
+        return vnode_make (1, NULL, data, NULL, store);
+    }
+
+    int dir = store->comp (node->data, data) < 0;
+    int red = node->red;
+    struct rbvnode* link[2];
+    void* cur = vnode_open (node, &link[0], &link[1], store);
+
+    link[dir] = vnode_insert (link[dir], data, store);
+
+    return red ? vnode_make (1, link[0], cur, link[1], store) : vnode_balance (link[0], cur, link[1], store);
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : vnode_left
+// =========================================================================
+struct rbvnode* vnode_left (struct rbvnode* l, void* x, struct rbvnode* r, struct rbvstore* store)
+{
+    // the left side lost one black node.
+    if (vnode_red (l))
+    {
+        return vnode_make (1, vnode_paint (l, 0, store), x, r, store);
+    }
+
+    if (vnode_black (r))
+    {
+        return vnode_balance (l, x, vnode_paint (r, 1, store), store);
+    }
+
+    struct rbvnode *s, *a, *b, *c;
+    void* z = vnode_open (r, &s, &c, store);
+    void* y = vnode_open (s, &a, &b, store);
+
+    return vnode_make (1, vnode_make (0, l, x, a, store), y, vnode_balance (b, z, vnode_paint (c, 1, store), store), store);
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : vnode_right
+// =========================================================================
+struct rbvnode* vnode_right (struct rbvnode* l, void* x, struct rbvnode* r, struct rbvstore* store)
+{
+    // the right side lost one black node.
+    if (vnode_red (r))
+    {
+        return vnode_make (1, l, x, vnode_paint (r, 0, store), store);
+    }
+
+    if (vnode_black (l))
+    {
+        return vnode_balance (vnode_paint (l, 1, store), x, r, store);
+    }
+
+    struct rbvnode *s, *a, *b, *c;
+    void* y = vnode_open (l, &a, &s, store);
+    void* z = vnode_open (s, &b, &c, store);
+
+    return vnode_make (1, vnode_balance (vnode_paint (a, 1, store), y, b, store), z, vnode_make (0, c, x, r, store), store);
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : vnode_append
+// =========================================================================
+struct rbvnode* vnode_append (struct rbvnode* l, struct rbvnode* r, struct rbvstore* store)
+{
+    struct rbvnode *a, *b, *c, *d, *m, *p, *q;
+    void *x, *y, *z;
+
+    if (l == NULL)
+        return r;
+    if (r == NULL)
+        return l;
+
+    if (l->red == r->red)
+    {
+        int red = l->red;
+
+        x = vnode_open (l, &a, &b, store);
+        y = vnode_open (r, &c, &d, store);
+        m = vnode_append (b, c, store);
+
+        if (vnode_red (m))
+        {
+            z = vnode_open (m, &p, &q, store);
+            return vnode_make (1, vnode_make (red, a, x, p, store), z, vnode_make (red, q, y, d, store), store);
+        }
+
+        return red ? vnode_make (1, a, x, vnode_make (1, m, y, d, store), store)
+                   : vnode_left (a, x, vnode_make (0, m, y, d, store), store);
+    }
+
+    if (r->red)
+    {
+        y = vnode_open (r, &b, &c, store);
+        return vnode_make (1, vnode_append (l, b, store), y, c, store);
+    }
+
+    x = vnode_open (l, &a, &b, store);
+    return vnode_make (1, a, x, vnode_append (b, r, store), store);
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : vnode_remove
+// =========================================================================
+struct rbvnode* vnode_remove (struct rbvnode* node, const void* data, struct rbvstore* store)
+{
+    if (node == NULL)
+    {
+        return NULL;
+    }
+
+    int comp = store->comp (node->data, data);
+    struct rbvnode *l, *r;
+
+    if (comp == 0)
+    {
+        vnode_open (node, &l, &r, store);
+        return vnode_append (l, r, store);
+    }
+
+    if (comp > 0)
+    {
+        int black = vnode_black (node->link[0]);
+        void* x = vnode_open (node, &l, &r, store);
+        l = vnode_remove (l, data, store);
+
+        return black ? vnode_left (l, x, r, store) : vnode_make (1, l, x, r, store);
+    }
+
+    int black = vnode_black (node->link[1]);
+    void* x = vnode_open (node, &l, &r, store);
+    r = vnode_remove (r, data, store);
+
+    return black ? vnode_right (l, x, r, store) : vnode_make (1, l, x, r, store);
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : store_reserve
+// =========================================================================
+int store_reserve (const struct rbversion* version, struct rbvstore* store)
+{
+    size_t height = 0;
+
+    for (struct rbvnode* node = version->root; node != NULL; node = node->link[0])
+    {
+        height += !node->red;
+    }
+
+    // a descent spans at most 2 * height + 1 levels, and the removal appends as deep again,
+    // each level building at most 8 nodes.
+    size_t need = 8 * (4 * height + 3);
+
+    while (store->nspare < need)
+    {
+        struct rbvnode* node = malloc (sizeof (struct rbvnode));
+
+        if (node == NULL)
+        {
+            return -1;
+        }
+
+        node->link[0] = store->spare;
+        store->spare = node;
+        ++store->nspare;
+    }
+
+    return 0;
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : make_version
+// =========================================================================
+struct rbversion* make_version (struct rbvstore* store, struct rbvnode* root, size_t count)
+{
+    struct rbversion* version = malloc (sizeof (struct rbversion));
+
+    if (version != NULL)
+    {
+        __atomic_fetch_add (&store->refs, 1, __ATOMIC_RELAXED);
+        version->store = store;
+        version->root = root;
+        version->count = count;
+    }
+
+    return version;
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rb_version_new
+// =========================================================================
+struct rbversion* rb_version_new (rb_compare* compare)
+{
+    struct rbvstore* store = malloc (sizeof (struct rbvstore));
+
+    if (store == NULL)
+    {
+        return NULL;
+    }
+
+    store->comp = compare;
+    store->refs = 0;
+    store->spare = NULL;
+    store->nspare = 0;
+
+    struct rbversion* version = make_version (store, NULL, 0);
+
+    if (version == NULL)
+    {
+        free (store);
+    }
+
+    return version;
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rb_version_delete
+// =========================================================================
+void rb_version_delete (struct rbversion* version)
+{
+    if (version != NULL)
+    {
+        struct rbvstore* store = version->store;
+
+        vnode_unref (version->root);
+        free (version);
+
+        if (__atomic_sub_fetch (&store->refs, 1, __ATOMIC_ACQ_REL) == 0)
+        {
+            while (store->spare != NULL)
+            {
+                struct rbvnode* next = store->spare->link[0];
+                free (store->spare);
+                store->spare = next;
+            }
+
+            free (store);
+        }
+    }
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rb_version_snapshot
+// =========================================================================
+struct rbversion* rb_version_snapshot (const struct rbversion* version)
+{
+    if (version == NULL)
+    {
+        return NULL;
+    }
+
+    struct rbversion* snapshot = make_version (version->store, version->root, version->count);
+
+    if (snapshot != NULL)
+    {
+        vnode_ref (version->root);
+    }
+
+    return snapshot;
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rb_version_insert
+// =========================================================================
+struct rbversion* rb_version_insert (void* data, const struct rbversion* version)
+{
+    if (version == NULL || rb_version_find (data, version) != NULL || store_reserve (version, version->store) != 0)
+    {
+        return NULL;
+    }
+
+    struct rbversion* next = make_version (version->store, NULL, version->count + 1);
+
+    if (next != NULL)
+    {
+        struct rbvnode* root = vnode_insert (vnode_ref (version->root), data, next->store);
+        next->root = vnode_paint (root, 0, next->store);
+    }
+
+    return next;
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rb_version_remove
+// =========================================================================
+struct rbversion* rb_version_remove (const void* data, const struct rbversion* version)
+{
+    if (version == NULL)
+    {
+        return NULL;
+    }
+
+    if (rb_version_find (data, version) == NULL)
+    {
+        return rb_version_snapshot (version);
+    }
+
+    if (store_reserve (version, version->store) != 0)
+    {
+        return NULL;
+    }
+
+    struct rbversion* next = make_version (version->store, NULL, version->count - 1);
+
+    if (next != NULL)
+    {
+        struct rbvnode* root = vnode_remove (vnode_ref (version->root), data, next->store);
+        next->root = vnode_paint (root, 0, next->store);
+    }
+
+    return next;
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rb_version_find
+// =========================================================================
+void* rb_version_find (const void* data, const struct rbversion* version)
+{
+    if (version != NULL)
+    {
+        struct rbvnode* node = version->root;
+
+        while (node != NULL)
+        {
+            int comp = version->store->comp (node->data, data);
+
+            if (comp == 0)
+                return node->data;
+            node = node->link[comp < 0];
+        }
+    }
+
+    return NULL;
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : rb_version_size
+// =========================================================================
+size_t rb_version_size (const struct rbversion* version)
+{
+    return (version != NULL) ? version->count : 0;
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : vs_beg
+// =========================================================================
+void* vs_beg (struct rbvsiter* it, const struct rbversion* version)
+{
+    if (it == NULL || version == NULL)
+    {
+        return NULL;
+    }
+
+    it->depth = 0;
+
+    for (struct rbvnode* node = version->root; node != NULL; node = node->link[0])
+    {
+        it->stack[it->depth++] = node;
+    }
+
+    return vs_cur (it);
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : vs_seek
+// =========================================================================
+void* vs_seek (struct rbvsiter* it, const struct rbversion* version, const void* data)
+{
+    if (it == NULL || version == NULL)
+    {
+        return NULL;
+    }
+
+    it->depth = 0;
+
+    // keep the nodes where the descent went left, the last one is the lower bound.
+    for (struct rbvnode* node = version->root; node != NULL;)
+    {
+        if (version->store->comp (node->data, data) < 0)
+        {
+            node = node->link[1];
+        }
+        else
+        {
+            it->stack[it->depth++] = node;
+            node = node->link[0];
+        }
+    }
+
+    return vs_cur (it);
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : vs_next
+// =========================================================================
+void* vs_next (struct rbvsiter* it)
+{
+    if (it == NULL || it->depth == 0)
+    {
+        return NULL;
+    }
+
+    struct rbvnode* node = it->stack[--it->depth]->link[1];
+
+    for (; node != NULL; node = node->link[0])
+    {
+        it->stack[it->depth++] = node;
+    }
+
+    return vs_cur (it);
+}
+
+// =========================================================================
+//   CLASS     :
+//   METHOD    : vs_cur
+// =========================================================================
+void* vs_cur (struct rbvsiter* it)
+{
+    return (it != NULL && it->depth > 0) ? it->stack[it->depth - 1]->data : NULL;
+}
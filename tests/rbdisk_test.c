@@ -0,0 +1,326 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2023 Mathieu Rabine
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// rbtree.
+#include <rbdisk.h>
+#include <rbiter.h>
+
+// libraries.
+#include <check.h>
+
+// C.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* elements are serialized as the key followed by a variable length payload */
+struct entry
+{
+    int            key;
+    size_t         size;
+};
+
+int compare (const void* left, const void* right)
+{
+    return (*(int*)(left) == *(int*)(right)) ? 0 : ((*(int*)(left) < *(int*)(right)) ? -1 : 1);
+}
+
+size_t serialize (const void* data, void* buffer, size_t size)
+{
+    const struct entry* entry = data;
+    size_t length = sizeof (int) + entry->size;
+
+    if (length <= size)
+    {
+        memcpy (buffer, &entry->key, sizeof (int));
+        memset ((char*)buffer + sizeof (int), entry->key & 0x7f, entry->size);
+    }
+
+    return length;
+}
+
+void temp_path (char* path)
+{
+    strcpy (path, "/tmp/rbdiskXXXXXX");
+    int fd = mkstemp (path);
+    ck_assert_int_ne (fd, -1);
+    close (fd);
+}
+
+void patch_file (const char* path, long offset, char value)
+{
+    FILE* file = fopen (path, "r+b");
+    ck_assert_ptr_ne (file, NULL);
+    fseek (file, offset, SEEK_SET);
+    fputc (value, file);
+    fclose (file);
+}
+
+START_TEST (test_rb_disk_write)
+{
+    struct rbtree* tree = rb_new (compare, NULL);
+    struct rbdiskiter it;
+    char path[32];
+    int key = 1;
+
+    temp_path (path);
+
+    /* empty tree */
+    ck_assert_int_eq (rb_disk_write (path, serialize, tree), 0);
+
+    struct rbdisk* disk = rb_disk_open (path, compare);
+    ck_assert_ptr_ne (disk, NULL);
+    ck_assert_int_eq (rb_disk_verify (disk), 0);
+    ck_assert_int_eq (rb_disk_size (disk), 0);
+    ck_assert_ptr_eq (rb_disk_find (&key, disk), NULL);
+    ck_assert_ptr_eq (dk_beg (&it, disk), NULL);
+    ck_assert_ptr_eq (dk_end (&it, disk), NULL);
+    ck_assert_ptr_eq (dk_next (&it), NULL);
+    rb_disk_close (disk);
+    rb_disk_close (NULL);
+
+    /* missing or invalid files */
+    ck_assert_ptr_eq (rb_disk_open ("/nonexistent/rbdisk", compare), NULL);
+    ck_assert_int_eq (truncate (path, 100), 0);
+    ck_assert_ptr_eq (rb_disk_open (path, compare), NULL);
+    ck_assert_int_eq (rb_disk_write ("/nonexistent/rbdisk", serialize, tree), -1);
+
+    unlink (path);
+    rb_delete (tree);
+}
+END_TEST
+
+START_TEST (test_rb_disk_find)
+{
+    enum { N = 2000 };
+    static struct entry entries[N];
+    struct rbtree* tree = rb_new (compare, NULL);
+    char path[32];
+
+    /* even keys, sizes up to past the write buffer */
+    for (int i = 0; i < N; ++i)
+    {
+        int k = (i * 71) % N;
+        entries[k].key = 2 * k;
+        entries[k].size = (k == N / 2) ? 200000 : (size_t)(k % 37);
+        rb_insert (&entries[k], tree);
+    }
+
+    temp_path (path);
+    ck_assert_int_eq (rb_disk_write (path, serialize, tree), 0);
+
+    struct rbdisk* disk = rb_disk_open (path, compare);
+    ck_assert_ptr_ne (disk, NULL);
+    ck_assert_int_eq (rb_disk_verify (disk), 0);
+    ck_assert_int_eq (rb_disk_size (disk), N);
+
+    for (int key = -1; key <= 2 * N; ++key)
+    {
+        struct entry* expected = rb_find (&key, tree);
+        int* found = rb_disk_find (&key, disk);
+
+        ck_assert ((expected == NULL) == (found == NULL));
+        if (found != NULL)
+        {
+            ck_assert_int_eq (*found, key);
+            ck_assert_int_eq ((uintptr_t)found % 8, 0);
+            ck_assert_int_eq (rb_disk_length (found), sizeof (int) + expected->size);
+            if (expected->size > 0)
+                ck_assert_int_eq (((unsigned char*)found)[sizeof (int) + expected->size - 1], key & 0x7f);
+        }
+
+        struct entry* lower = rb_lower_bound (&key, tree);
+        struct entry* upper = rb_upper_bound (&key, tree);
+        int* dlower = rb_disk_lower_bound (&key, disk);
+        int* dupper = rb_disk_upper_bound (&key, disk);
+
+        ck_assert (lower == NULL ? dlower == NULL : (dlower != NULL && *dlower == lower->key));
+        ck_assert (upper == NULL ? dupper == NULL : (dupper != NULL && *dupper == upper->key));
+    }
+
+    rb_disk_close (disk);
+    unlink (path);
+    rb_delete (tree);
+}
+END_TEST
+
+START_TEST (test_dk_iter)
+{
+    enum { N = 500 };
+    static struct entry entries[N];
+    struct rbtree* tree = rb_new (compare, NULL);
+    struct rbdiskiter it;
+    struct rbiter tit;
+    char path[32];
+
+    for (int i = 0; i < N; ++i)
+    {
+        entries[i].key = (i * 71) % N;
+        entries[i].size = (size_t)i % 13;
+        rb_insert (&entries[i], tree);
+    }
+
+    temp_path (path);
+    ck_assert_int_eq (rb_disk_write (path, serialize, tree), 0);
+    struct rbdisk* disk = rb_disk_open (path, compare);
+
+    /* same order as the tree, both ways */
+    struct entry* entry = it_beg (&tit, tree);
+    int count = 0;
+
+    for (int* data = dk_beg (&it, disk); data != NULL; data = dk_next (&it), entry = it_next (&tit), ++count)
+    {
+        ck_assert_int_eq (*data, entry->key);
+    }
+    ck_assert_ptr_eq (entry, NULL);
+    ck_assert_int_eq (count, N);
+
+    for (int* data = dk_end (&it, disk); data != NULL; data = dk_prev (&it))
+    {
+        ck_assert_int_eq (*data, --count);
+    }
+    ck_assert_int_eq (count, 0);
+
+    int key = N / 2;
+    ck_assert_int_eq (*(int*)dk_seek (&it, disk, &key), N / 2);
+    ck_assert_int_eq (*(int*)dk_cur (&it), N / 2);
+    ck_assert_int_eq (*(int*)dk_next (&it), N / 2 + 1);
+    ck_assert_int_eq (*(int*)dk_prev (&it), N / 2);
+    key = N;
+    ck_assert_ptr_eq (dk_seek (&it, disk, &key), NULL);
+
+    rb_disk_close (disk);
+    unlink (path);
+    rb_delete (tree);
+}
+END_TEST
+
+START_TEST (test_rb_disk_records)
+{
+    enum { N = 10000 };
+    static struct entry entries[N];
+    struct rbtree* tree = rb_new (compare, NULL);
+    struct rbdiskiter it;
+    char path[32];
+
+    /* 16 bytes per record, the write buffer fills up exactly several times */
+    for (int i = 0; i < N; ++i)
+    {
+        entries[i].key = i;
+        entries[i].size = (i < N / 2) ? 0 : 4;
+        rb_insert (&entries[i], tree);
+    }
+
+    temp_path (path);
+    ck_assert_int_eq (rb_disk_write (path, serialize, tree), 0);
+
+    struct rbdisk* disk = rb_disk_open (path, compare);
+    ck_assert_ptr_ne (disk, NULL);
+    ck_assert_int_eq (rb_disk_verify (disk), 0);
+    ck_assert_int_eq (rb_disk_size (disk), N);
+
+    int key = 0;
+    for (int* data = dk_beg (&it, disk); data != NULL; data = dk_next (&it), ++key)
+    {
+        ck_assert_int_eq (*data, key);
+        ck_assert_int_eq (rb_disk_length (data), sizeof (int) + entries[key].size);
+    }
+    ck_assert_int_eq (key, N);
+
+    rb_disk_close (disk);
+    unlink (path);
+    rb_delete (tree);
+}
+END_TEST
+
+START_TEST (test_rb_disk_verify)
+{
+    static struct entry entries[100];
+    struct rbtree* tree = rb_new (compare, NULL);
+    char path[32];
+
+    for (int i = 0; i < 100; ++i)
+    {
+        entries[i].key = i;
+        entries[i].size = 10;
+        rb_insert (&entries[i], tree);
+    }
+
+    temp_path (path);
+    ck_assert_int_eq (rb_disk_write (path, serialize, tree), 0);
+
+    /* a damaged record is only caught by the full check */
+    patch_file (path, 2 * RB_DISK_PAGE + 100, 0x55);
+    struct rbdisk* disk = rb_disk_open (path, compare);
+    ck_assert_ptr_ne (disk, NULL);
+    ck_assert_int_eq (rb_disk_verify (disk), -1);
+    rb_disk_close (disk);
+
+    /* a damaged header fails to open */
+    ck_assert_int_eq (rb_disk_write (path, serialize, tree), 0);
+    patch_file (path, 16, 0x55);
+    ck_assert_ptr_eq (rb_disk_open (path, compare), NULL);
+
+    /* equal records of a multimap are in order */
+    struct rbtree* multi = rb_new_ex (compare, NULL, RB_MULTI, NULL);
+    for (int i = 0; i < 100; ++i)
+    {
+        entries[i].key = i / 10;
+        rb_insert (&entries[i], multi);
+    }
+
+    ck_assert_int_eq (rb_disk_write (path, serialize, multi), 0);
+    disk = rb_disk_open (path, compare);
+    ck_assert_ptr_ne (disk, NULL);
+    ck_assert_int_eq (rb_disk_verify (disk), 0);
+    ck_assert_int_eq (rb_disk_size (disk), 100);
+    rb_disk_close (disk);
+    rb_delete (multi);
+
+    unlink (path);
+    rb_delete (tree);
+}
+END_TEST
+
+int main (void)
+{
+    Suite* s = suite_create ("rbdisk");
+    TCase* core = tcase_create ("core");
+
+    suite_add_tcase (s, core);
+    tcase_add_test (core, test_rb_disk_write);
+    tcase_add_test (core, test_rb_disk_find);
+    tcase_add_test (core, test_dk_iter);
+    tcase_add_test (core, test_rb_disk_records);
+    tcase_add_test (core, test_rb_disk_verify);
+
+    SRunner* runner = srunner_create (s);
+    srunner_set_fork_status (runner, CK_NOFORK);
+    srunner_run_all (runner, CK_ENV);
+    int nf = srunner_ntests_failed (runner);
+    srunner_free (runner);
+
+    return nf == 0 ? 0 : 1;
+}
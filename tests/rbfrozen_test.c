@@ -0,0 +1,248 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2023 Mathieu Rabine
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// rbtree.
+#include <rbfrozen.h>
+
+// libraries.
+#include <check.h>
+
+// C.
+#include <stddef.h>
+#include <stdlib.h>
+
+int compare (const void* left, const void* right)
+{
+    return (*(int*)(left) == *(int*)(right)) ? 0 : ((*(int*)(left) < *(int*)(right)) ? -1 : 1);
+}
+
+struct entry
+{
+    int32_t   i32;
+    int64_t   i64;
+    uint64_t  u64;
+};
+
+int compare_entry (const void* left, const void* right)
+{
+    const struct entry* l = left;
+    const struct entry* r = right;
+
+    return (l->i32 == r->i32) ? 0 : ((l->i32 < r->i32) ? -1 : 1);
+}
+
+START_TEST (test_rb_freeze)
+{
+    struct rbtree* tree = rb_new (compare, NULL);
+    struct rbfrozen* frozen = rb_freeze (tree);
+    struct rbfziter it;
+    int key = 1;
+
+    /* empty snapshot */
+    ck_assert_ptr_ne (frozen, NULL);
+    ck_assert_int_eq (rb_frozen_size (frozen), 0);
+    ck_assert_ptr_eq (rb_frozen_find (&key, frozen), NULL);
+    ck_assert_ptr_eq (rb_frozen_lower_bound (&key, frozen), NULL);
+    ck_assert_ptr_eq (fz_beg (&it, frozen), NULL);
+    ck_assert_ptr_eq (fz_end (&it, frozen), NULL);
+    ck_assert_ptr_eq (fz_next (&it), NULL);
+
+    rb_frozen_delete (frozen);
+    rb_frozen_delete (NULL);
+    rb_delete (tree);
+}
+END_TEST
+
+START_TEST (test_rb_frozen_find)
+{
+    /* every size up to a few complete levels */
+    for (int n = 1; n <= 70; ++n)
+    {
+        int vals[70];
+        struct rbtree* tree = rb_new (compare, NULL);
+
+        for (int i = 0; i < n; ++i)
+        {
+            vals[i] = 2 * ((i * 71) % n);
+            rb_insert (&vals[i], tree);
+        }
+
+        struct rbfrozen* frozen = rb_freeze (tree);
+        ck_assert_int_eq (rb_frozen_size (frozen), n);
+
+        for (int key = -1; key <= 2 * n; ++key)
+        {
+            int* found = rb_frozen_find (&key, frozen);
+            int* lower = rb_frozen_lower_bound (&key, frozen);
+            int* upper = rb_frozen_upper_bound (&key, frozen);
+
+            ck_assert_ptr_eq (found, rb_find (&key, tree));
+            ck_assert_ptr_eq (lower, rb_lower_bound (&key, tree));
+            ck_assert_ptr_eq (upper, rb_upper_bound (&key, tree));
+        }
+
+        rb_frozen_delete (frozen);
+        rb_delete (tree);
+    }
+}
+END_TEST
+
+START_TEST (test_fz_iter)
+{
+    for (int n = 1; n <= 70; ++n)
+    {
+        int vals[70];
+        struct rbtree* tree = rb_new (compare, NULL);
+        struct rbfziter it;
+
+        for (int i = 0; i < n; ++i)
+        {
+            vals[i] = (i * 71) % n;
+            rb_insert (&vals[i], tree);
+        }
+
+        struct rbfrozen* frozen = rb_freeze (tree);
+
+        /* forward */
+        int expected = 0;
+        for (int* data = fz_beg (&it, frozen); data != NULL; data = fz_next (&it))
+        {
+            ck_assert_int_eq (*data, expected++);
+        }
+        ck_assert_int_eq (expected, n);
+
+        /* backward */
+        for (int* data = fz_end (&it, frozen); data != NULL; data = fz_prev (&it))
+        {
+            ck_assert_int_eq (*data, --expected);
+        }
+        ck_assert_int_eq (expected, 0);
+
+        /* seek then walk */
+        int key = n / 2;
+        ck_assert_int_eq (*(int*)fz_seek (&it, frozen, &key), n / 2);
+        ck_assert_int_eq (*(int*)fz_cur (&it), n / 2);
+        if (n / 2 + 1 < n)
+            ck_assert_int_eq (*(int*)fz_next (&it), n / 2 + 1);
+        key = n;
+        ck_assert_ptr_eq (fz_seek (&it, frozen, &key), NULL);
+
+        rb_frozen_delete (frozen);
+        rb_delete (tree);
+    }
+}
+END_TEST
+
+START_TEST (test_rb_frozen_index)
+{
+    struct entry entries[200];
+
+    /* keys sort alike as int32, int64 and uint64, including both ends of each range */
+    for (int i = 0; i < 200; ++i)
+    {
+        entries[i].i32 = (i == 199) ? INT32_MAX : (i == 0) ? INT32_MIN : 4 * (i - 100);
+        entries[i].i64 = (i == 199) ? INT64_MAX : (i == 0) ? INT64_MIN : (int64_t)entries[i].i32 * 1048576;
+        entries[i].u64 = (i == 199) ? UINT64_MAX : (uint64_t)i << 56;
+    }
+
+    ck_assert_int_eq (rb_frozen_index (RB_KEY_I32, 0, RB_SIMD_AUTO, NULL), -1);
+
+    for (int n = 0; n <= 200; n += (n < 40) ? 1 : 23)
+    {
+        struct rbtree* tree = rb_new (compare_entry, NULL);
+
+        /* the first n entries plus the largest one */
+        for (int i = 0; i < n; ++i)
+            rb_insert (&entries[(i * 71) % n], tree);
+        if (n > 0)
+            rb_insert (&entries[199], tree);
+
+        struct rbfrozen* frozen = rb_freeze (tree);
+
+        ck_assert_int_eq (rb_frozen_index (0, 0, RB_SIMD_AUTO, frozen), -1);
+        ck_assert_ptr_eq (rb_frozen_find_i32 (0, frozen), NULL);
+
+        for (int simd = RB_SIMD_NONE; simd <= RB_SIMD_AVX2; ++simd)
+        {
+            ck_assert_int_eq (rb_frozen_index (RB_KEY_I32, offsetof (struct entry, i32), simd, frozen), 0);
+            ck_assert_int_le (frozen->simd, simd);
+            ck_assert_ptr_eq (rb_frozen_find_i64 (0, frozen), NULL);
+
+            for (int i = 0; i < 200; ++i)
+            {
+                struct entry probe = entries[i];
+
+                ck_assert_ptr_eq (rb_frozen_find_i32 (probe.i32, frozen), rb_find (&probe, tree));
+                ck_assert_ptr_eq (rb_frozen_lower_bound_i32 (probe.i32, frozen), rb_lower_bound (&probe, tree));
+                probe.i32 += (i < 199);
+                ck_assert_ptr_eq (rb_frozen_find_i32 (probe.i32, frozen), rb_find (&probe, tree));
+                ck_assert_ptr_eq (rb_frozen_lower_bound_i32 (probe.i32, frozen), rb_lower_bound (&probe, tree));
+            }
+
+            ck_assert_int_eq (rb_frozen_index (RB_KEY_I64, offsetof (struct entry, i64), simd, frozen), 0);
+
+            for (int i = 0; i < 200; ++i)
+            {
+                ck_assert_ptr_eq (rb_frozen_find_i64 (entries[i].i64, frozen), rb_find (&entries[i], tree));
+                ck_assert_ptr_eq (rb_frozen_lower_bound_i64 (entries[i].i64, frozen), rb_lower_bound (&entries[i], tree));
+            }
+
+            ck_assert_int_eq (rb_frozen_index (RB_KEY_U64, offsetof (struct entry, u64), simd, frozen), 0);
+
+            for (int i = 0; i < 200; ++i)
+            {
+                struct entry probe = entries[i];
+
+                ck_assert_ptr_eq (rb_frozen_find_u64 (probe.u64, frozen), rb_find (&probe, tree));
+                ck_assert_ptr_eq (rb_frozen_lower_bound_u64 (probe.u64, frozen), rb_lower_bound (&probe, tree));
+                probe.i32 += (i < 199);
+                ck_assert_ptr_eq (rb_frozen_lower_bound_u64 (probe.u64 + (i < 199), frozen), rb_lower_bound (&probe, tree));
+            }
+        }
+
+        rb_frozen_delete (frozen);
+        rb_delete (tree);
+    }
+}
+END_TEST
+
+int main (void)
+{
+    Suite* s = suite_create ("rbfrozen");
+    TCase* core = tcase_create ("core");
+
+    suite_add_tcase (s, core);
+    tcase_add_test (core, test_rb_freeze);
+    tcase_add_test (core, test_rb_frozen_find);
+    tcase_add_test (core, test_fz_iter);
+    tcase_add_test (core, test_rb_frozen_index);
+
+    SRunner* runner = srunner_create (s);
+    srunner_set_fork_status (runner, CK_NOFORK);
+    srunner_run_all (runner, CK_ENV);
+    int nf = srunner_ntests_failed (runner);
+    srunner_free (runner);
+
+    return nf == 0 ? 0 : 1;
+}
@@ -0,0 +1,202 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2023 Mathieu Rabine
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// rbtree.
+#include <rbgen.h>
+#include <rbiter.h>
+
+// libraries.
+#include <check.h>
+
+// C.
+#include <stdlib.h>
+#include <string.h>
+
+struct word
+{
+    const char*    text;
+    struct rbnode  link;
+};
+
+RB_GENERATE (word, struct word, link, const char*, text, strcmp)
+
+START_TEST (test_rb_int)
+{
+    struct rbint elm[5] = { { .key = 3 }, { .key = 1 }, { .key = 5 }, { .key = 2 }, { .key = 4 } };
+    struct rbint dup = { .key = 3 };
+    struct rbtree* tree = rb_new_ex (rb_int_compare, NULL, RB_INTRUSIVE, NULL);
+
+    ck_assert_ptr_ne (tree, NULL);
+
+    /* try to find elements */
+    ck_assert_ptr_eq (rb_int_find (1, tree), NULL);
+
+    /* insert elements */
+    for (int i = 0; i < 5; ++i)
+    {
+        ck_assert_ptr_eq (rb_int_insert (&elm[i], tree), &elm[i]);
+    }
+
+    /* try to insert elements again */
+    ck_assert_ptr_eq (rb_int_insert (&dup, tree), NULL);
+    ck_assert_int_eq (rb_size (tree), 5);
+
+    /* find elements */
+    for (int i = 0; i < 5; ++i)
+    {
+        ck_assert_ptr_eq (rb_int_find (elm[i].key, tree), &elm[i]);
+    }
+
+    /* generic api */
+    ck_assert_ptr_eq (rb_find (&dup.node, tree), &elm[0].node);
+
+    /* remove elements */
+    ck_assert_ptr_eq (rb_int_remove (3, tree), &elm[0]);
+    ck_assert_ptr_eq (rb_int_remove (3, tree), NULL);
+    ck_assert_ptr_eq (rb_int_find (3, tree), NULL);
+    ck_assert_ptr_eq (rb_int_remove (1, tree), &elm[1]);
+    ck_assert_int_eq (rb_size (tree), 3);
+
+    /* remaining elements */
+    ck_assert_ptr_eq (rb_int_find (2, tree), &elm[3]);
+    ck_assert_ptr_eq (rb_int_find (4, tree), &elm[4]);
+    ck_assert_ptr_eq (rb_int_find (5, tree), &elm[2]);
+
+    rb_delete (tree);
+}
+END_TEST
+
+START_TEST (test_rb_u64)
+{
+    struct rbu64 elm[3] = { { .key = UINT64_MAX }, { .key = 0 }, { .key = (uint64_t)1 << 63 } };
+    struct rbtree* tree = rb_new_ex (rb_u64_compare, NULL, RB_INTRUSIVE, NULL);
+    struct rbiter it;
+
+    ck_assert_ptr_ne (tree, NULL);
+
+    /* insert elements */
+    for (int i = 0; i < 3; ++i)
+    {
+        ck_assert_ptr_eq (rb_u64_insert (&elm[i], tree), &elm[i]);
+    }
+
+    /* keys are compared unsigned */
+    ck_assert_ptr_eq (it_beg (&it, tree), &elm[1].node);
+    ck_assert_ptr_eq (it_next (&it), &elm[2].node);
+    ck_assert_ptr_eq (it_next (&it), &elm[0].node);
+    ck_assert_ptr_eq (it_next (&it), NULL);
+
+    /* find elements */
+    ck_assert_ptr_eq (rb_u64_find (UINT64_MAX, tree), &elm[0]);
+    ck_assert_ptr_eq (rb_u64_find (1, tree), NULL);
+
+    rb_delete (tree);
+}
+END_TEST
+
+START_TEST (test_rb_generate)
+{
+    struct word words[4] = { { .text = "pear" }, { .text = "apple" }, { .text = "plum" }, { .text = "fig" } };
+    struct rbtree* tree = rb_new_ex (word_compare, NULL, RB_INTRUSIVE, NULL);
+    struct rbiter it;
+
+    ck_assert_ptr_ne (tree, NULL);
+
+    /* insert elements */
+    for (int i = 0; i < 4; ++i)
+    {
+        ck_assert_ptr_eq (word_insert (&words[i], tree), &words[i]);
+    }
+
+    /* iterate threw elements */
+    ck_assert_str_eq (rb_entry (it_beg (&it, tree), struct word, link)->text, "apple");
+    ck_assert_str_eq (rb_entry (it_next (&it), struct word, link)->text, "fig");
+    ck_assert_str_eq (rb_entry (it_next (&it), struct word, link)->text, "pear");
+    ck_assert_str_eq (rb_entry (it_next (&it), struct word, link)->text, "plum");
+
+    /* find and remove elements */
+    ck_assert_ptr_eq (word_find ("fig", tree), &words[3]);
+    ck_assert_ptr_eq (word_remove ("fig", tree), &words[3]);
+    ck_assert_ptr_eq (word_find ("fig", tree), NULL);
+    ck_assert_int_eq (rb_size (tree), 3);
+
+    rb_delete (tree);
+}
+END_TEST
+
+START_TEST (test_rb_link)
+{
+    struct rbint* elm = malloc (1000 * sizeof (struct rbint));
+    struct rbtree* tree = rb_new_ex (rb_int_compare, NULL, RB_INTRUSIVE, NULL);
+    struct rbiter it;
+
+    ck_assert_ptr_ne (elm, NULL);
+
+    /* insert elements in scattered order */
+    for (int i = 0; i < 1000; ++i)
+    {
+        elm[i].key = (i * 7919) % 1000;
+        ck_assert_ptr_eq (rb_int_insert (&elm[i], tree), &elm[i]);
+    }
+
+    /* remove even keys */
+    for (int i = 0; i < 1000; i += 2)
+    {
+        ck_assert_ptr_ne (rb_int_remove (i, tree), NULL);
+    }
+
+    /* check remaining keys are ordered */
+    int expected = 1;
+    for (struct rbnode* node = it_beg (&it, tree); node != NULL; node = it_next (&it))
+    {
+        ck_assert_int_eq (rb_entry (node, struct rbint, node)->key, expected);
+        expected += 2;
+    }
+    ck_assert_int_eq (expected, 1001);
+    ck_assert_int_eq (rb_size (tree), 500);
+
+    rb_delete (tree);
+    free (elm);
+}
+END_TEST
+
+int main (void)
+{
+    Suite* s = suite_create ("rbgen");
+    TCase* core = tcase_create ("core");
+
+    suite_add_tcase (s, core);
+    tcase_add_test (core, test_rb_int);
+    tcase_add_test (core, test_rb_u64);
+    tcase_add_test (core, test_rb_generate);
+    tcase_add_test (core, test_rb_link);
+
+    SRunner* runner = srunner_create (s);
+    srunner_set_fork_status (runner, CK_NOFORK);
+    srunner_run_all (runner, CK_ENV);
+    int nf = srunner_ntests_failed (runner);
+    srunner_free (runner);
+
+    return nf == 0 ? 0 : 1;
+}
@@ -0,0 +1,152 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2023 Mathieu Rabine
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// rbtree.
+#include <rbinterval.h>
+
+// libraries.
+#include <check.h>
+
+// C.
+#include <stdlib.h>
+
+int count (void* data, void* ctx)
+{
+    (void) data;
+    ++*(int*)ctx;
+    return 0;
+}
+
+int first (void* data, void* ctx)
+{
+    *(struct rbinterval**)ctx = data;
+    return 1;
+}
+
+START_TEST (test_rb_interval_new)
+{
+    struct rbtree* tree = rb_interval_new (NULL);
+
+    ck_assert_ptr_ne (tree, NULL);
+    ck_assert_ptr_ne (tree->augment, NULL);
+
+    rb_delete (tree);
+}
+END_TEST
+
+START_TEST (test_rb_stab)
+{
+    struct rbinterval iv[4] = { { .lo = 1, .hi = 5 }, { .lo = 3, .hi = 4 }, { .lo = 6, .hi = 9 }, { .lo = 3, .hi = 4 } };
+    struct rbinterval* found = NULL;
+    struct rbtree* tree = rb_interval_new (NULL);
+    int n = 0;
+
+    /* insert intervals, equal intervals are distinct elements */
+    for (int i = 0; i < 4; ++i)
+    {
+        ck_assert_ptr_eq (rb_insert (&iv[i], tree), &iv[i]);
+    }
+
+    /* check stabbing queries */
+    ck_assert_int_eq (rb_stab (0, count, &n, tree), 0);
+    ck_assert_int_eq (rb_stab (1, count, &n, tree), 1);
+    ck_assert_int_eq (rb_stab (3, count, &n, tree), 3);
+    ck_assert_int_eq (rb_stab (5, count, &n, tree), 1);
+    ck_assert_int_eq (rb_stab (7, count, &n, tree), 1);
+    ck_assert_int_eq (rb_stab (10, count, &n, tree), 0);
+    ck_assert_int_eq (n, 6);
+
+    /* stop early */
+    ck_assert_int_eq (rb_stab (8, first, &found, tree), 1);
+    ck_assert_ptr_eq (found, &iv[2]);
+
+    /* remove an interval */
+    rb_remove (&iv[0], tree);
+    ck_assert_int_eq (rb_stab (1, count, &n, tree), 0);
+    ck_assert_int_eq (rb_stab (4, count, &n, tree), 2);
+
+    rb_delete (tree);
+}
+END_TEST
+
+START_TEST (test_rb_overlap)
+{
+    struct rbinterval* iv = malloc (500 * sizeof (struct rbinterval));
+    struct rbtree* tree = rb_interval_new (NULL);
+
+    ck_assert_ptr_ne (iv, NULL);
+
+    /* insert pseudo random intervals */
+    srand (1);
+    for (int i = 0; i < 500; ++i)
+    {
+        iv[i].lo = rand () % 1000;
+        iv[i].hi = iv[i].lo + rand () % 50;
+        ck_assert_ptr_eq (rb_insert (&iv[i], tree), &iv[i]);
+    }
+
+    /* remove a third of them */
+    for (int i = 0; i < 500; i += 3)
+    {
+        rb_remove (&iv[i], tree);
+    }
+
+    /* compare queries with a linear scan */
+    for (long lo = -10; lo < 1100; lo += 7)
+    {
+        int n = 0, expected = 0;
+
+        for (int i = 0; i < 500; ++i)
+        {
+            if (i % 3 != 0 && iv[i].lo <= lo + 5 && iv[i].hi >= lo)
+                ++expected;
+        }
+
+        ck_assert_int_eq (rb_overlap (lo, lo + 5, count, &n, tree), expected);
+        ck_assert_int_eq (n, expected);
+    }
+
+    rb_delete (tree);
+    free (iv);
+}
+END_TEST
+
+int main (void)
+{
+    Suite* s = suite_create ("rbinterval");
+    TCase* core = tcase_create ("core");
+
+    suite_add_tcase (s, core);
+    tcase_add_test (core, test_rb_interval_new);
+    tcase_add_test (core, test_rb_stab);
+    tcase_add_test (core, test_rb_overlap);
+
+    SRunner* runner = srunner_create (s);
+    srunner_set_fork_status (runner, CK_NOFORK);
+    srunner_run_all (runner, CK_ENV);
+    int nf = srunner_ntests_failed (runner);
+    srunner_free (runner);
+
+    return nf == 0 ? 0 : 1;
+}
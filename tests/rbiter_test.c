@@ -79,6 +79,37 @@ START_TEST (test_it_end)
 }
 END_TEST
 
+START_TEST (test_it_seek)
+{
+    int val1 = 1, val3 = 3, val5 = 5, key;
+    struct rbtree* tree = rb_new (compare, NULL);
+    struct rbiter  it;
+
+    /* insert nodes */
+    ck_assert_ptr_eq (rb_insert (&val1, tree), &val1);
+    ck_assert_ptr_eq (rb_insert (&val3, tree), &val3);
+    ck_assert_ptr_eq (rb_insert (&val5, tree), &val5);
+
+    /* seek existing node */
+    key = 3;
+    ck_assert_ptr_eq (it_seek (&it, tree, &key), &val3);
+    ck_assert_ptr_eq (it_next (&it), &val5);
+    ck_assert_ptr_eq (it_next (&it), NULL);
+
+    /* seek between nodes */
+    key = 2;
+    ck_assert_ptr_eq (it_seek (&it, tree, &key), &val3);
+    ck_assert_ptr_eq (it_prev (&it), &val1);
+
+    /* seek past the last node */
+    key = 6;
+    ck_assert_ptr_eq (it_seek (&it, tree, &key), NULL);
+    ck_assert_ptr_eq (it_cur (&it), NULL);
+
+    rb_delete (tree);
+}
+END_TEST
+
 START_TEST (test_it_next)
 {
     int val1 = 1, val2 = 2, val3 = 3, val4 = 4, val5 = 5;
@@ -200,6 +231,133 @@ START_TEST (test_it_cur)
 }
 END_TEST
 
+START_TEST (test_it_erase)
+{
+    int vals[12] = { 1, 2, 2, 2, 2, 3, 5, 5, 7, 7, 7, 9 };
+    struct rbtree* tree = rb_new_ex (compare, NULL, RB_MULTI, NULL);
+    struct rbiter  first, last;
+    int key = 7;
+
+    for (int i = 11; i >= 0; --i)
+    {
+        ck_assert_ptr_eq (rb_insert (&vals[i], tree), &vals[i]);
+    }
+
+    /* equal elements are walked in insertion order, here the reverse of the array */
+    ck_assert_ptr_eq (rb_equal_range (&key, &first, &last, tree), &vals[10]);
+    ck_assert_ptr_eq (it_cur (&last), &vals[11]);
+    ck_assert_ptr_eq (it_next (&first), &vals[9]);
+    ck_assert_ptr_eq (it_next (&first), &vals[8]);
+    ck_assert_ptr_eq (it_next (&first), &vals[11]);
+    ck_assert_ptr_eq (first.node, last.node);
+
+    /* absent elements give an empty range */
+    key = 4;
+    ck_assert_ptr_eq (rb_equal_range (&key, &first, &last, tree), NULL);
+    ck_assert_ptr_eq (first.node, last.node);
+    ck_assert_ptr_eq (it_cur (&last), &vals[7]);
+    key = 10;
+    ck_assert_ptr_eq (rb_equal_range (&key, &first, &last, tree), NULL);
+    ck_assert_ptr_eq (it_cur (&last), NULL);
+
+    /* erase the middle duplicates of 2 */
+    key = 2;
+    ck_assert_ptr_eq (rb_equal_range (&key, &first, &last, tree), &vals[4]);
+    ck_assert_ptr_eq (it_next (&first), &vals[3]);
+    ck_assert_ptr_eq (it_erase (&first), &vals[2]);
+    ck_assert_ptr_eq (it_erase (&first), &vals[1]);
+    ck_assert_int_eq (rb_size (tree), 10);
+
+    int* data = rb_equal_range (&key, &first, &last, tree);
+    ck_assert_ptr_eq (data, &vals[4]);
+    ck_assert_ptr_eq (it_next (&first), &vals[1]);
+    ck_assert_ptr_eq (it_next (&first), it_cur (&last));
+
+    /* erase everything from the front */
+    int count = 0;
+    for (data = it_beg (&first, tree); data != NULL; data = it_erase (&first))
+    {
+        ++count;
+    }
+    ck_assert_int_eq (count, 10);
+    ck_assert (rb_empty (tree));
+    ck_assert_ptr_eq (it_erase (&first), NULL);
+
+    rb_delete (tree);
+}
+END_TEST
+
+START_TEST (test_rb_insert_hint)
+{
+    int vals[1000], extra[3] = { 499, 2000, -1 };
+    struct rbtree* tree = rb_new_ex (compare, NULL, RB_RANK, NULL);
+    struct rbiter  it, wrong;
+
+    /* append increasing keys with the iterator left on the last one */
+    ck_assert_ptr_eq (it_end (&it, tree), NULL);
+    for (int i = 0; i < 1000; i += 2)
+    {
+        vals[i] = i;
+        ck_assert_ptr_eq (rb_insert_hint (&vals[i], &it, tree), &vals[i]);
+        ck_assert_ptr_eq (it_cur (&it), &vals[i]);
+    }
+
+    /* fill the gaps, hinting before the next element then after the previous one */
+    for (int i = 1; i < 1000; i += 2)
+    {
+        vals[i] = i;
+        if (i % 4 == 1)
+            it_seek (&it, tree, &vals[i - 1]), it_next (&it);
+        else
+            it_seek (&it, tree, &vals[i - 1]);
+        ck_assert_ptr_eq (rb_insert_hint (&vals[i], &it, tree), &vals[i]);
+        ck_assert_ptr_eq (it_cur (&it), &vals[i]);
+    }
+
+    /* wrong hints fall back to a descent, equal elements are refused */
+    it_beg (&wrong, tree);
+    ck_assert_ptr_eq (rb_insert_hint (&extra[1], &wrong, tree), &extra[1]);
+    ck_assert_ptr_eq (it_cur (&wrong), &extra[1]);
+    ck_assert_ptr_eq (rb_insert_hint (&extra[2], NULL, tree), &extra[2]);
+    ck_assert_ptr_eq (rb_insert_hint (&extra[0], &wrong, tree), NULL);
+    it_seek (&it, tree, &extra[0]);
+    ck_assert_ptr_eq (rb_insert_hint (&extra[0], &it, tree), NULL);
+    ck_assert_ptr_eq (it_cur (&it), &vals[499]);
+    ck_assert_int_eq (rb_size (tree), 1002);
+
+    int expected = -1;
+    for (int* data = it_beg (&it, tree); data != NULL; data = it_next (&it))
+    {
+        ck_assert_int_eq (*data, expected);
+        expected = (expected == 999) ? 2000 : expected + 1;
+    }
+    ck_assert_int_eq (*(int*)rb_select (500, tree), 499);
+    ck_assert_ptr_eq (it_end (&it, tree), &extra[1]);
+
+    rb_delete (tree);
+
+    /* equal elements keep insertion order whatever the hint */
+    int dups[4] = { 5, 5, 5, 5 };
+    struct rbiter first, last;
+
+    tree = rb_new_ex (compare, NULL, RB_MULTI, NULL);
+    ck_assert_ptr_eq (rb_insert_hint (&dups[0], NULL, tree), &dups[0]);
+    ck_assert_ptr_eq (rb_insert_hint (&dups[1], NULL, tree), &dups[1]);
+    it_beg (&it, tree);
+    ck_assert_ptr_eq (rb_insert_hint (&dups[2], &it, tree), &dups[2]);
+    it_end (&it, tree);
+    it_next (&it);
+    ck_assert_ptr_eq (rb_insert_hint (&dups[3], &it, tree), &dups[3]);
+
+    ck_assert_ptr_eq (rb_equal_range (&dups[0], &first, &last, tree), &dups[0]);
+    for (int i = 1; i < 4; ++i)
+        ck_assert_ptr_eq (it_next (&first), &dups[i]);
+    ck_assert_ptr_eq (it_next (&first), NULL);
+
+    rb_delete (tree);
+}
+END_TEST
+
 int main (void)
 {
     Suite* s = suite_create ("rbiter");
@@ -209,8 +367,11 @@ int main (void)
     tcase_add_test (core, test_it_beg);
     tcase_add_test (core, test_it_end);
     tcase_add_test (core, test_it_cur);
+    tcase_add_test (core, test_it_seek);
     tcase_add_test (core, test_it_next);
     tcase_add_test (core, test_it_prev);
+    tcase_add_test (core, test_it_erase);
+    tcase_add_test (core, test_rb_insert_hint);
 
     SRunner* runner = srunner_create (s);
     srunner_set_fork_status (runner, CK_NOFORK);
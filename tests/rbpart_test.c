@@ -0,0 +1,237 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2023 Mathieu Rabine
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// rbtree.
+#include <rbpart.h>
+
+// libraries.
+#include <check.h>
+
+// C.
+#include <stdlib.h>
+
+#define KEYS 4096
+
+int compare (const void* left, const void* right)
+{
+    return (*(int*)(left) == *(int*)(right)) ? 0 : ((*(int*)(left) < *(int*)(right)) ? -1 : 1);
+}
+
+size_t hash_split (const void* data, size_t nparts, void* ctx)
+{
+    (void)ctx;
+    return ((unsigned int)*(int*)data * 2654435761u) % nparts;
+}
+
+size_t range_split (const void* data, size_t nparts, void* ctx)
+{
+    size_t part = *(int*)data / *(int*)ctx;
+    return (part < nparts) ? part : nparts - 1;
+}
+
+size_t bad_split (const void* data, size_t nparts, void* ctx)
+{
+    (void)ctx;
+    return (*(int*)data < 0) ? nparts : 0;
+}
+
+struct worker
+{
+    struct rbpart*  tree;
+    int*            keys;
+    int             first;
+};
+
+void* insert_thread (void* arg)
+{
+    struct worker* w = arg;
+
+    for (int i = w->first; i < KEYS; i += 4)
+    {
+        rb_part_insert (&w->keys[i], w->tree);
+    }
+
+    return NULL;
+}
+
+START_TEST (test_rb_part_new)
+{
+    ck_assert_ptr_eq (rb_part_new (compare, NULL, 0, hash_split, NULL), NULL);
+    ck_assert_ptr_eq (rb_part_new (compare, NULL, 4, NULL, NULL), NULL);
+
+    struct rbpart* tree = rb_part_new (compare, NULL, 8, hash_split, NULL);
+
+    ck_assert_ptr_ne (tree, NULL);
+    ck_assert_int_eq (tree->nparts, 8);
+    ck_assert_int_eq (rb_part_size (tree), 0);
+    ck_assert_int_eq ((size_t)&tree->parts[1] - (size_t)&tree->parts[0], 64);
+
+    rb_part_delete (tree);
+}
+END_TEST
+
+START_TEST (test_rb_part_insert)
+{
+    struct rbpart* tree = rb_part_new (compare, NULL, 4, hash_split, NULL);
+    int keys[] = {7, 3, 11, 5, 1, 9};
+
+    for (int i = 0; i < 6; ++i)
+    {
+        ck_assert_ptr_eq (rb_part_insert (&keys[i], tree), &keys[i]);
+    }
+
+    int dup = 7;
+    ck_assert_ptr_eq (rb_part_insert (&dup, tree), NULL);
+    ck_assert_ptr_eq (rb_part_find (&dup, tree), &keys[0]);
+    ck_assert_int_eq (rb_part_size (tree), 6);
+
+    rb_part_remove (&dup, tree);
+    ck_assert_ptr_eq (rb_part_find (&dup, tree), NULL);
+    ck_assert_int_eq (rb_part_size (tree), 5);
+
+    rb_part_delete (tree);
+}
+END_TEST
+
+START_TEST (test_rb_part_split)
+{
+    struct rbpart* tree = rb_part_new (compare, NULL, 2, bad_split, NULL);
+    int good = 1, bad = -1;
+
+    ck_assert_ptr_eq (rb_part_insert (&good, tree), &good);
+
+    /* an index out of range is refused rather than used */
+    ck_assert_ptr_eq (rb_part_insert (&bad, tree), NULL);
+    ck_assert_ptr_eq (rb_part_find (&bad, tree), NULL);
+    rb_part_remove (&bad, tree);
+    ck_assert_int_eq (rb_part_size (tree), 1);
+    ck_assert_ptr_eq (rb_part_find (&good, tree), &good);
+
+    rb_part_delete (tree);
+}
+END_TEST
+
+START_TEST (test_rb_part_iter)
+{
+    int width = 100;
+    struct rbpart* hashed = rb_part_new (compare, NULL, 5, hash_split, NULL);
+    struct rbpart* ranged = rb_part_new (compare, NULL, 5, range_split, &width);
+    struct rbpartiter it;
+    int keys[500];
+
+    ck_assert_ptr_eq (rb_part_beg (&it, hashed), NULL);
+
+    for (int i = 0; i < 500; ++i)
+    {
+        keys[i] = (i * 37) % 500;
+        rb_part_insert (&keys[i], hashed);
+        rb_part_insert (&keys[i], ranged);
+    }
+
+    int expected = 0;
+    for (int* data = rb_part_beg (&it, hashed); data != NULL; data = rb_part_next (&it))
+    {
+        ck_assert_int_eq (*data, expected++);
+    }
+    ck_assert_int_eq (expected, 500);
+
+    expected = 0;
+    for (int* data = rb_part_beg (&it, ranged); data != NULL; data = rb_part_next (&it))
+    {
+        ck_assert_int_eq (*data, expected++);
+    }
+    ck_assert_int_eq (expected, 500);
+
+    /* early release lets writers in */
+    ck_assert_int_eq (*(int*)rb_part_beg (&it, hashed), 0);
+    rb_part_release (&it);
+    rb_part_release (&it);
+    ck_assert_ptr_eq (rb_part_next (&it), NULL);
+    rb_part_remove (&keys[0], hashed);
+    ck_assert_int_eq (*(int*)rb_part_beg (&it, hashed), 1);
+    rb_part_release (&it);
+
+    rb_part_delete (hashed);
+    rb_part_delete (ranged);
+}
+END_TEST
+
+START_TEST (test_rb_part_threads)
+{
+    struct rbpart* tree = rb_part_new (compare, NULL, 16, hash_split, NULL);
+    struct worker workers[4];
+    pthread_t ids[4];
+    int* keys = malloc (KEYS * sizeof (int));
+
+    for (int i = 0; i < KEYS; ++i)
+    {
+        keys[i] = i;
+    }
+
+    for (int i = 0; i < 4; ++i)
+    {
+        workers[i] = (struct worker){tree, keys, i};
+        pthread_create (&ids[i], NULL, insert_thread, &workers[i]);
+    }
+
+    for (int i = 0; i < 4; ++i)
+    {
+        pthread_join (ids[i], NULL);
+    }
+
+    ck_assert_int_eq (rb_part_size (tree), KEYS);
+
+    struct rbpartiter it;
+    int expected = 0;
+    for (int* data = rb_part_beg (&it, tree); data != NULL; data = rb_part_next (&it))
+    {
+        ck_assert_int_eq (*data, expected++);
+    }
+    ck_assert_int_eq (expected, KEYS);
+
+    rb_part_delete (tree);
+    free (keys);
+}
+END_TEST
+
+int main (void)
+{
+    Suite* s = suite_create ("rbpart");
+    TCase* core = tcase_create ("core");
+
+    suite_add_tcase (s, core);
+    tcase_add_test (core, test_rb_part_new);
+    tcase_add_test (core, test_rb_part_insert);
+    tcase_add_test (core, test_rb_part_split);
+    tcase_add_test (core, test_rb_part_iter);
+    tcase_add_test (core, test_rb_part_threads);
+
+    SRunner* runner = srunner_create (s);
+    srunner_set_fork_status (runner, CK_NOFORK);
+    srunner_run_all (runner, CK_ENV);
+    int nf = srunner_ntests_failed (runner);
+    srunner_free (runner);
+
+    return nf == 0 ? 0 : 1;
+}
@@ -0,0 +1,217 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2023 Mathieu Rabine
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// rbtree.
+#include <rbrcu.h>
+
+// libraries.
+#include <check.h>
+
+// C.
+#include <stdlib.h>
+#include <time.h>
+
+#define KEYS 512
+
+int compare (const void* left, const void* right)
+{
+    return (*(int*)(left) == *(int*)(right)) ? 0 : ((*(int*)(left) < *(int*)(right)) ? -1 : 1);
+}
+
+void destroy (void* data)
+{
+    *(int*)data = -1;
+    free (data);
+}
+
+int* make_int (int val)
+{
+    int* data = malloc (sizeof (int));
+    *data = val;
+    return data;
+}
+
+struct shared
+{
+    struct rbrcu*  tree;
+    int            stop;
+    int            errors;
+    long           lookups;
+};
+
+void* reader_thread (void* arg)
+{
+    struct shared* shared = arg;
+    struct rbreader* reader = rb_rcu_register (shared->tree);
+    unsigned int seed = (unsigned int)(size_t)reader;
+    long lookups = 0;
+    int errors = 0;
+
+    while (!__atomic_load_n (&shared->stop, __ATOMIC_RELAXED))
+    {
+        rb_rcu_read_lock (reader);
+
+        for (int i = 0; i < 64; ++i)
+        {
+            int key = rand_r (&seed) % KEYS;
+            int* found = rb_rcu_find (&key, reader);
+
+            /* even keys are always there, odd keys come and go but are never torn */
+            if ((key % 2 == 0 && found == NULL) || (found != NULL && *found != key))
+                ++errors;
+            ++lookups;
+        }
+
+        rb_rcu_read_unlock (reader);
+    }
+
+    rb_rcu_unregister (reader);
+
+    __atomic_fetch_add (&shared->errors, errors, __ATOMIC_RELAXED);
+    __atomic_fetch_add (&shared->lookups, lookups, __ATOMIC_RELAXED);
+
+    return NULL;
+}
+
+START_TEST (test_rb_rcu_new)
+{
+    struct rbrcu* tree = rb_rcu_new (compare, destroy);
+
+    ck_assert_ptr_ne (tree, NULL);
+    ck_assert_int_eq (rb_rcu_size (tree), 0);
+
+    rb_rcu_delete (tree);
+}
+END_TEST
+
+START_TEST (test_rb_rcu_find)
+{
+    struct rbrcu* tree = rb_rcu_new (compare, destroy);
+    struct rbreader* reader = rb_rcu_register (tree);
+    int* val1 = make_int (1);
+    int* val2 = make_int (2);
+    int key = 1;
+
+    ck_assert_ptr_ne (reader, NULL);
+
+    /* insert nodes */
+    ck_assert_ptr_eq (rb_rcu_insert (val1, tree), val1);
+    ck_assert_ptr_eq (rb_rcu_insert (val2, tree), val2);
+    ck_assert_ptr_eq (rb_rcu_insert (val1, tree), NULL);
+    ck_assert_int_eq (rb_rcu_size (tree), 2);
+
+    /* find nodes */
+    rb_rcu_read_lock (reader);
+    ck_assert_ptr_eq (rb_rcu_find (&key, reader), val1);
+    key = 2;
+    ck_assert_ptr_eq (rb_rcu_find (&key, reader), val2);
+    key = 3;
+    ck_assert_ptr_eq (rb_rcu_find (&key, reader), NULL);
+    rb_rcu_read_unlock (reader);
+
+    /* remove nodes */
+    key = 1;
+    rb_rcu_remove (&key, tree);
+    ck_assert_int_eq (rb_rcu_size (tree), 1);
+
+    rb_rcu_read_lock (reader);
+    ck_assert_ptr_eq (rb_rcu_find (&key, reader), NULL);
+    rb_rcu_read_unlock (reader);
+
+    rb_rcu_unregister (reader);
+    rb_rcu_delete (tree);
+}
+END_TEST
+
+START_TEST (test_rb_rcu_stress)
+{
+    struct shared shared = { rb_rcu_new (compare, destroy), 0, 0, 0 };
+    pthread_t readers[4];
+    struct timespec start, now;
+    unsigned int seed = 42;
+
+    ck_assert_ptr_ne (shared.tree, NULL);
+
+    /* even keys are permanent */
+    for (int key = 0; key < KEYS; key += 2)
+    {
+        ck_assert_ptr_ne (rb_rcu_insert (make_int (key), shared.tree), NULL);
+    }
+
+    for (int i = 0; i < 4; ++i)
+    {
+        ck_assert_int_eq (pthread_create (&readers[i], NULL, reader_thread, &shared), 0);
+    }
+
+    /* toggle odd keys while readers are running */
+    clock_gettime (CLOCK_MONOTONIC, &start);
+    do
+    {
+        int key = 2 * (rand_r (&seed) % (KEYS / 2)) + 1;
+        int* data = make_int (key);
+
+        if (rb_rcu_insert (data, shared.tree) == NULL)
+        {
+            free (data);
+            rb_rcu_remove (&key, shared.tree);
+        }
+
+        clock_gettime (CLOCK_MONOTONIC, &now);
+    }
+    while ((now.tv_sec - start.tv_sec) * 1000000000L + (now.tv_nsec - start.tv_nsec) < 500000000L);
+
+    __atomic_store_n (&shared.stop, 1, __ATOMIC_RELAXED);
+
+    for (int i = 0; i < 4; ++i)
+    {
+        pthread_join (readers[i], NULL);
+    }
+
+    ck_assert_int_eq (shared.errors, 0);
+    ck_assert_int_gt (shared.lookups, 0);
+    ck_assert_int_ge (rb_rcu_size (shared.tree), KEYS / 2);
+
+    rb_rcu_delete (shared.tree);
+}
+END_TEST
+
+int main (void)
+{
+    Suite* s = suite_create ("rbrcu");
+    TCase* core = tcase_create ("core");
+
+    suite_add_tcase (s, core);
+    tcase_set_timeout (core, 30);
+    tcase_add_test (core, test_rb_rcu_new);
+    tcase_add_test (core, test_rb_rcu_find);
+    tcase_add_test (core, test_rb_rcu_stress);
+
+    SRunner* runner = srunner_create (s);
+    srunner_set_fork_status (runner, CK_NOFORK);
+    srunner_run_all (runner, CK_ENV);
+    int nf = srunner_ntests_failed (runner);
+    srunner_free (runner);
+
+    return nf == 0 ? 0 : 1;
+}
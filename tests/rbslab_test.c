@@ -0,0 +1,223 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2023 Mathieu Rabine
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// rbtree.
+#include <rbslab.h>
+
+// libraries.
+#include <check.h>
+
+// C.
+#include <stdlib.h>
+
+int compare (const void* left, const void* right)
+{
+    return (*(int*)(left) == *(int*)(right)) ? 0 : ((*(int*)(left) < *(int*)(right)) ? -1 : 1);
+}
+
+int destroyed = 0;
+
+void destroy (void* data)
+{
+    (void) data;
+    ++destroyed;
+}
+
+/* slab allocator counting live nodes */
+struct counted
+{
+    struct rballoc slab;
+    size_t         live;
+    void*          last_alloc;
+    void*          last_free;
+};
+
+void* counted_alloc (size_t size, void* ctx)
+{
+    struct counted* counted = ctx;
+    void* node = counted->slab.alloc (size, counted->slab.ctx);
+
+    counted->live += (node != NULL);
+    counted->last_alloc = node;
+    return node;
+}
+
+void counted_free (void* ptr, void* ctx)
+{
+    struct counted* counted = ctx;
+
+    --counted->live;
+    counted->last_free = ptr;
+    counted->slab.free (ptr, counted->slab.ctx);
+}
+
+void counted_release (void* ctx)
+{
+    struct counted* counted = ctx;
+
+    counted->slab.release (counted->slab.ctx);
+}
+
+START_TEST (test_rb_slab)
+{
+    struct rballoc alloc;
+
+    ck_assert_int_eq (rb_slab (NULL), -1);
+    ck_assert_int_eq (rb_slab (&alloc), 0);
+    ck_assert_ptr_ne (alloc.alloc, NULL);
+    ck_assert_ptr_ne (alloc.free, NULL);
+    ck_assert_ptr_ne (alloc.release, NULL);
+    ck_assert_ptr_ne (alloc.ctx, NULL);
+
+    alloc.release (alloc.ctx);
+}
+END_TEST
+
+START_TEST (test_rb_slab_recycle)
+{
+    struct rballoc alloc;
+
+    ck_assert_int_eq (rb_slab (&alloc), 0);
+
+    /* allocate nodes */
+    void* node1 = alloc.alloc (40, alloc.ctx);
+    void* node2 = alloc.alloc (40, alloc.ctx);
+    ck_assert_ptr_ne (node1, NULL);
+    ck_assert_ptr_ne (node2, NULL);
+    ck_assert_ptr_ne (node1, node2);
+
+    /* freed nodes are handed out again */
+    alloc.free (node1, alloc.ctx);
+    ck_assert_ptr_eq (alloc.alloc (40, alloc.ctx), node1);
+
+    /* nodes larger than the slab size are rejected */
+    ck_assert_ptr_eq (alloc.alloc (64, alloc.ctx), NULL);
+
+    alloc.release (alloc.ctx);
+}
+END_TEST
+
+START_TEST (test_rb_slab_tree)
+{
+    int* vals = malloc (10000 * sizeof (int));
+    struct counted counted = { .live = 0, .last_alloc = NULL, .last_free = NULL };
+    struct rballoc alloc;
+
+    ck_assert_ptr_ne (vals, NULL);
+    ck_assert_int_eq (rb_slab (&counted.slab), 0);
+
+    /* the wrapper keeps the release function, removed nodes must still be freed */
+    alloc.alloc = counted_alloc;
+    alloc.free = counted_free;
+    alloc.release = counted_release;
+    alloc.ctx = &counted;
+
+    struct rbtree* tree = rb_new_ex (compare, NULL, 0, &alloc);
+    ck_assert_ptr_ne (tree, NULL);
+
+    /* insert nodes spanning several chunks */
+    for (int i = 0; i < 10000; ++i)
+    {
+        vals[i] = i;
+        ck_assert_ptr_eq (rb_insert (&vals[i], tree), &vals[i]);
+    }
+
+    /* remove half of them */
+    for (int i = 0; i < 10000; i += 2)
+    {
+        rb_remove (&vals[i], tree);
+    }
+
+    ck_assert_int_eq (counted.live, 5000);
+
+    /* insert them again from the freelist */
+    for (int i = 0; i < 10000; i += 2)
+    {
+        ck_assert_ptr_eq (rb_insert (&vals[i], tree), &vals[i]);
+    }
+    ck_assert_int_eq (counted.live, 10000);
+
+    /* remove then insert cycles hand back the same node */
+    for (int i = 0; i < 1000; ++i)
+    {
+        rb_remove (&vals[i], tree);
+        ck_assert_int_eq (counted.live, 9999);
+        ck_assert_ptr_eq (rb_insert (&vals[i], tree), &vals[i]);
+        ck_assert_ptr_eq (counted.last_alloc, counted.last_free);
+    }
+    ck_assert_int_eq (counted.live, 10000);
+
+    /* check nodes */
+    ck_assert_int_eq (rb_size (tree), 10000);
+    for (int i = 0; i < 10000; ++i)
+    {
+        ck_assert_ptr_eq (rb_find (&vals[i], tree), &vals[i]);
+    }
+
+    rb_delete (tree);
+    free (vals);
+}
+END_TEST
+
+START_TEST (test_rb_slab_destroy)
+{
+    int val1 = 1, val2 = 2, val3 = 3;
+    struct rballoc alloc;
+
+    ck_assert_int_eq (rb_slab (&alloc), 0);
+
+    struct rbtree* tree = rb_new_ex (compare, destroy, 0, &alloc);
+    ck_assert_ptr_ne (tree, NULL);
+
+    /* insert nodes */
+    ck_assert_ptr_eq (rb_insert (&val1, tree), &val1);
+    ck_assert_ptr_eq (rb_insert (&val2, tree), &val2);
+    ck_assert_ptr_eq (rb_insert (&val3, tree), &val3);
+
+    /* data are still deleted */
+    destroyed = 0;
+    rb_delete (tree);
+    ck_assert_int_eq (destroyed, 3);
+}
+END_TEST
+
+int main (void)
+{
+    Suite* s = suite_create ("rbslab");
+    TCase* core = tcase_create ("core");
+
+    suite_add_tcase (s, core);
+    tcase_add_test (core, test_rb_slab);
+    tcase_add_test (core, test_rb_slab_recycle);
+    tcase_add_test (core, test_rb_slab_tree);
+    tcase_add_test (core, test_rb_slab_destroy);
+
+    SRunner* runner = srunner_create (s);
+    srunner_set_fork_status (runner, CK_NOFORK);
+    srunner_run_all (runner, CK_ENV);
+    int nf = srunner_ntests_failed (runner);
+    srunner_free (runner);
+
+    return nf == 0 ? 0 : 1;
+}
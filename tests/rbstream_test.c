@@ -0,0 +1,242 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2023 Mathieu Rabine
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// rbtree.
+#include <rbstream.h>
+#include <rbiter.h>
+
+// libraries.
+#include <check.h>
+
+// C.
+#include <stdlib.h>
+#include <string.h>
+
+/* in memory stream */
+struct memory
+{
+    char*          data;
+    size_t         len;
+    size_t         cap;
+    size_t         pos;
+    size_t         chunk;
+};
+
+int destroyed = 0;
+
+int compare (const void* left, const void* right)
+{
+    return (*(int*)(left) == *(int*)(right)) ? 0 : ((*(int*)(left) < *(int*)(right)) ? -1 : 1);
+}
+
+int reverse (const void* left, const void* right)
+{
+    return compare (right, left);
+}
+
+void destroy (void* data)
+{
+    ++destroyed;
+    free (data);
+}
+
+/* elements are an int followed by as many bytes as its value modulo 300 */
+size_t serialize (const void* data, void* buffer, size_t size)
+{
+    int val = *(const int*)data;
+    size_t length = sizeof (int) + (size_t)(val % 300);
+
+    if (length <= size)
+    {
+        memcpy (buffer, &val, sizeof (int));
+        memset ((char*)buffer + sizeof (int), val & 0x7f, length - sizeof (int));
+    }
+
+    return length;
+}
+
+void* deserialize (const void* buffer, size_t size)
+{
+    int* val = malloc (sizeof (int));
+
+    memcpy (val, buffer, sizeof (int));
+    ck_assert_int_eq (size, sizeof (int) + (size_t)(*val % 300));
+
+    return val;
+}
+
+int mem_write (const void* data, size_t size, void* ctx)
+{
+    struct memory* mem = ctx;
+
+    if (mem->len + size > mem->cap)
+    {
+        mem->cap = 2 * (mem->len + size);
+        mem->data = realloc (mem->data, mem->cap);
+    }
+
+    memcpy (mem->data + mem->len, data, size);
+    mem->len += size;
+
+    return 0;
+}
+
+int fail_write (const void* data, size_t size, void* ctx)
+{
+    (void)data, (void)size, (void)ctx;
+
+    return -1;
+}
+
+/* hands out at most chunk bytes at a time so that records straddle reads */
+size_t mem_read (void* data, size_t size, void* ctx)
+{
+    struct memory* mem = ctx;
+    size_t n = mem->len - mem->pos;
+
+    n = (n < size) ? n : size;
+    n = (n < mem->chunk) ? n : mem->chunk;
+    memcpy (data, mem->data + mem->pos, n);
+    mem->pos += n;
+
+    return n;
+}
+
+struct rbtree* make_tree (int n, rb_compare* comp, int flags)
+{
+    struct rbtree* tree = rb_new_ex (comp, destroy, flags, NULL);
+
+    for (int i = 0; i < n; ++i)
+    {
+        int* val = malloc (sizeof (int));
+        *val = (i * 7919) % n;
+        rb_insert (val, tree);
+    }
+
+    return tree;
+}
+
+START_TEST (test_rb_stream)
+{
+    size_t chunks[] = { 1, 7, 4096, 1 << 20 };
+
+    for (int n = 0; n <= 3000; n += (n < 20) ? 1 : 997)
+    {
+        for (size_t c = 0; c < sizeof (chunks) / sizeof (chunks[0]); ++c)
+        {
+            struct memory mem = { NULL, 0, 0, 0, chunks[c] };
+            struct rbtree* tree = make_tree (n, compare, 0);
+            struct rbtree* copy = rb_new_ex (compare, destroy, RB_RANK, NULL);
+            struct rbiter it, cit;
+
+            ck_assert_int_eq (rb_stream_write (mem_write, &mem, serialize, tree), 0);
+            ck_assert_int_eq (rb_stream_read (mem_read, &mem, deserialize, copy), 0);
+            ck_assert_int_eq (rb_size (copy), n);
+            ck_assert_int_eq (mem.pos, mem.len);
+
+            /* same elements in the same order, and the rank data is maintained */
+            int* cval = it_beg (&cit, copy);
+            for (int* val = it_beg (&it, tree); val != NULL; val = it_next (&it), cval = it_next (&cit))
+            {
+                ck_assert_int_eq (*val, *cval);
+                ck_assert_int_eq (*(int*)rb_select ((size_t)*val, copy), *val);
+            }
+            ck_assert_ptr_eq (cval, NULL);
+
+            /* the tree stays usable */
+            int* extra = malloc (sizeof (int));
+            *extra = n;
+            ck_assert_ptr_eq (rb_insert (extra, copy), extra);
+            rb_remove (&(int){ 0 }, copy);
+            ck_assert_int_eq (rb_size (copy), n);
+
+            rb_delete (tree);
+            rb_delete (copy);
+            free (mem.data);
+        }
+    }
+}
+END_TEST
+
+START_TEST (test_rb_stream_fail)
+{
+    struct memory mem = { NULL, 0, 0, 0, 100 };
+    struct rbtree* tree = make_tree (1000, compare, 0);
+    struct rbtree* copy = rb_new (compare, destroy);
+
+    ck_assert_int_eq (rb_stream_write (fail_write, NULL, serialize, tree), -1);
+    ck_assert_int_eq (rb_stream_write (mem_write, &mem, serialize, tree), 0);
+
+    /* truncated stream, the elements read so far are released */
+    size_t len = mem.len;
+    mem.len = len / 2;
+    destroyed = 0;
+    ck_assert_int_eq (rb_stream_read (mem_read, &mem, deserialize, copy), -1);
+    ck_assert (rb_empty (copy));
+    ck_assert_int_gt (destroyed, 0);
+
+    /* damaged header */
+    mem.len = len;
+    mem.pos = 0;
+    mem.data[0] = 'X';
+    ck_assert_int_eq (rb_stream_read (mem_read, &mem, deserialize, copy), -1);
+    ck_assert (rb_empty (copy));
+
+    /* elements out of order are refused */
+    struct rbtree* reversed = make_tree (1000, reverse, 0);
+    mem.len = mem.pos = 0;
+    ck_assert_int_eq (rb_stream_write (mem_write, &mem, serialize, reversed), 0);
+    destroyed = 0;
+    ck_assert_int_eq (rb_stream_read (mem_read, &mem, deserialize, copy), -1);
+    ck_assert (rb_empty (copy));
+    ck_assert_int_eq (destroyed, 2);
+
+    /* the target tree must be empty */
+    mem.pos = 0;
+    ck_assert_int_eq (rb_stream_read (mem_read, &mem, deserialize, tree), -1);
+
+    rb_delete (tree);
+    rb_delete (reversed);
+    rb_delete (copy);
+    free (mem.data);
+}
+END_TEST
+
+int main (void)
+{
+    Suite* s = suite_create ("rbstream");
+    TCase* core = tcase_create ("core");
+
+    suite_add_tcase (s, core);
+    tcase_add_test (core, test_rb_stream);
+    tcase_add_test (core, test_rb_stream_fail);
+
+    SRunner* runner = srunner_create (s);
+    srunner_set_fork_status (runner, CK_NOFORK);
+    srunner_run_all (runner, CK_ENV);
+    int nf = srunner_ntests_failed (runner);
+    srunner_free (runner);
+
+    return nf == 0 ? 0 : 1;
+}
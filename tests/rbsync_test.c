@@ -0,0 +1,334 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2023 Mathieu Rabine
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// rbtree.
+#include <rbsync.h>
+
+// libraries.
+#include <check.h>
+
+// C.
+#include <sched.h>
+#include <stdlib.h>
+
+#define KEYS 512
+
+int compare (const void* left, const void* right)
+{
+    return (*(int*)(left) == *(int*)(right)) ? 0 : ((*(int*)(left) < *(int*)(right)) ? -1 : 1);
+}
+
+struct shared
+{
+    struct rbsync*  tree;
+    int             keys[KEYS];
+    int             stop;
+    int             errors;
+};
+
+void* reader_thread (void* arg)
+{
+    struct shared* shared = arg;
+    unsigned int seed = (unsigned int)(size_t)&seed;
+    int errors = 0;
+
+    while (!__atomic_load_n (&shared->stop, __ATOMIC_RELAXED))
+    {
+        int key = rand_r (&seed) % KEYS;
+        int* found = rb_sync_find (&key, shared->tree);
+
+        /* even keys are always there */
+        if ((key % 2 == 0 && found == NULL) || (found != NULL && *found != key))
+        {
+            ++errors;
+        }
+
+        /* a full walk must see a sorted sequence */
+        struct rbsynciter it;
+        int last = -1;
+
+        for (int* data = rb_sync_beg (&it, shared->tree); data != NULL; data = rb_sync_next (&it))
+        {
+            if (*data <= last)
+            {
+                ++errors;
+            }
+
+            last = *data;
+        }
+    }
+
+    __atomic_fetch_add (&shared->errors, errors, __ATOMIC_RELAXED);
+
+    return NULL;
+}
+
+START_TEST (test_rb_sync_new)
+{
+    struct rbsync* tree = rb_sync_new (compare, NULL);
+
+    ck_assert_ptr_ne (tree, NULL);
+    ck_assert_int_eq (rb_sync_size (tree), 0);
+    ck_assert_int_eq ((size_t)tree->shards % 64, 0);
+    ck_assert_int_eq ((size_t)&tree->shards[1] - (size_t)&tree->shards[0], 64);
+
+    rb_sync_delete (tree);
+}
+END_TEST
+
+START_TEST (test_rb_sync_iter)
+{
+    struct rbsync* tree = rb_sync_new (compare, NULL);
+    struct rbsynciter it;
+    int keys[] = {5, 1, 3, 2, 4};
+
+    ck_assert_ptr_eq (rb_sync_beg (&it, tree), NULL);
+    ck_assert_int_eq (it.held, 0);
+
+    for (int i = 0; i < 5; ++i)
+    {
+        ck_assert_ptr_eq (rb_sync_insert (&keys[i], tree), &keys[i]);
+    }
+
+    ck_assert_int_eq (*(int*)rb_sync_find (&keys[2], tree), 3);
+
+    int expected = 1;
+    for (int* data = rb_sync_beg (&it, tree); data != NULL; data = rb_sync_next (&it))
+    {
+        ck_assert_int_eq (it.held, 1);
+        ck_assert_int_eq (*data, expected++);
+    }
+
+    ck_assert_int_eq (expected, 6);
+    ck_assert_int_eq (it.held, 0);
+
+    /* an iterator released early lets writers in */
+    ck_assert_int_eq (*(int*)rb_sync_beg (&it, tree), 1);
+    rb_sync_release (&it);
+    rb_sync_release (&it);
+    rb_sync_remove (&keys[1], tree);
+    ck_assert_ptr_eq (rb_sync_next (&it), NULL);
+    ck_assert_int_eq (rb_sync_size (tree), 4);
+
+    rb_sync_delete (tree);
+}
+END_TEST
+
+void* writer_thread (void* arg)
+{
+    struct shared* shared = arg;
+
+    rb_sync_insert (&shared->keys[1], shared->tree);
+
+    return NULL;
+}
+
+START_TEST (test_rb_sync_reenter)
+{
+    struct shared shared = {0};
+    struct rbsynciter it, nested;
+    pthread_t writer;
+
+    shared.tree = rb_sync_new (compare, NULL);
+    shared.keys[0] = 0;
+    shared.keys[1] = 1;
+    rb_sync_insert (&shared.keys[0], shared.tree);
+
+    /* an open iterator holds the read lock while a writer queues up */
+    ck_assert_ptr_eq (rb_sync_beg (&it, shared.tree), &shared.keys[0]);
+    pthread_create (&writer, NULL, writer_thread, &shared);
+    while (!__atomic_load_n (&shared.tree->writer, __ATOMIC_SEQ_CST))
+    {
+        sched_yield ();
+    }
+
+    /* the same thread reads again without waiting for the writer */
+    ck_assert_ptr_eq (rb_sync_find (&shared.keys[0], shared.tree), &shared.keys[0]);
+    ck_assert_ptr_eq (rb_sync_beg (&nested, shared.tree), &shared.keys[0]);
+    ck_assert_ptr_eq (rb_sync_next (&nested), NULL);
+    ck_assert_int_eq (rb_sync_size (shared.tree), 1);
+
+    /* the writer gets in once the outer lock is released */
+    ck_assert_ptr_eq (rb_sync_next (&it), NULL);
+    pthread_join (writer, NULL);
+    ck_assert_int_eq (rb_sync_size (shared.tree), 2);
+
+    rb_sync_delete (shared.tree);
+}
+END_TEST
+
+void* release_thread (void* arg)
+{
+    struct rbsynciter* it = arg;
+
+    rb_sync_release (it);
+
+    return (void*)(size_t)rb_sync_read_unlock (it->sync);
+}
+
+START_TEST (test_rb_sync_owner)
+{
+    struct shared shared = {0};
+    struct rbsynciter it;
+    pthread_t other, writer;
+    void* result = NULL;
+
+    shared.tree = rb_sync_new (compare, NULL);
+    shared.keys[0] = 0;
+    shared.keys[1] = 1;
+    rb_sync_insert (&shared.keys[0], shared.tree);
+    ck_assert_int_eq (rb_sync_read_unlock (shared.tree), -1);
+
+    /* another thread cannot release the lock of this one */
+    ck_assert_ptr_eq (rb_sync_beg (&it, shared.tree), &shared.keys[0]);
+    pthread_create (&other, NULL, release_thread, &it);
+    pthread_join (other, &result);
+    ck_assert_int_eq ((int)(size_t)result, -1);
+    ck_assert_int_eq (it.held, 1);
+
+    /* the counters are intact, the writer gets in once the owner releases */
+    pthread_create (&writer, NULL, writer_thread, &shared);
+    while (!__atomic_load_n (&shared.tree->writer, __ATOMIC_SEQ_CST))
+    {
+        sched_yield ();
+    }
+
+    ck_assert_int_eq (rb_sync_size (shared.tree), 1);
+    rb_sync_release (&it);
+    ck_assert_int_eq (it.held, 0);
+    pthread_join (writer, NULL);
+    ck_assert_int_eq (rb_sync_size (shared.tree), 2);
+
+    rb_sync_delete (shared.tree);
+}
+END_TEST
+
+START_TEST (test_rb_sync_nested)
+{
+    struct rbsync* trees[RB_SYNC_NESTED + 1];
+    struct rbsynciter it;
+    int key = 1;
+
+    for (int i = 0; i <= RB_SYNC_NESTED; ++i)
+    {
+        trees[i] = rb_sync_new (compare, NULL);
+        rb_sync_insert (&key, trees[i]);
+    }
+
+    for (int i = 0; i < RB_SYNC_NESTED; ++i)
+    {
+        ck_assert_int_eq (rb_sync_read_lock (trees[i]), 0);
+    }
+
+    /* one tree too many is refused rather than locked untracked */
+    ck_assert_int_eq (rb_sync_read_lock (trees[RB_SYNC_NESTED]), -1);
+    ck_assert_ptr_eq (rb_sync_find (&key, trees[RB_SYNC_NESTED]), NULL);
+    ck_assert_ptr_eq (rb_sync_beg (&it, trees[RB_SYNC_NESTED]), NULL);
+    ck_assert_int_eq (it.held, 0);
+
+    /* trees already held are still re-entered */
+    ck_assert_ptr_eq (rb_sync_find (&key, trees[0]), &key);
+
+    for (int i = 0; i < RB_SYNC_NESTED; ++i)
+    {
+        ck_assert_int_eq (rb_sync_read_unlock (trees[i]), 0);
+    }
+
+    ck_assert_ptr_eq (rb_sync_find (&key, trees[RB_SYNC_NESTED]), &key);
+
+    for (int i = 0; i <= RB_SYNC_NESTED; ++i)
+    {
+        rb_sync_remove (&key, trees[i]);
+        ck_assert_int_eq (rb_sync_size (trees[i]), 0);
+        rb_sync_delete (trees[i]);
+    }
+}
+END_TEST
+
+START_TEST (test_rb_sync_stress)
+{
+    struct shared shared = {0};
+    pthread_t readers[4];
+
+    shared.tree = rb_sync_new (compare, NULL);
+
+    for (int i = 0; i < KEYS; ++i)
+    {
+        shared.keys[i] = i;
+
+        if (i % 2 == 0)
+        {
+            rb_sync_insert (&shared.keys[i], shared.tree);
+        }
+    }
+
+    for (int i = 0; i < 4; ++i)
+    {
+        pthread_create (&readers[i], NULL, reader_thread, &shared);
+    }
+
+    for (int round = 0; round < 2000; ++round)
+    {
+        int key = (round * 7 % KEYS) | 1;
+
+        rb_sync_insert (&shared.keys[key], shared.tree);
+        rb_sync_remove (&shared.keys[key], shared.tree);
+    }
+
+    __atomic_store_n (&shared.stop, 1, __ATOMIC_RELAXED);
+
+    for (int i = 0; i < 4; ++i)
+    {
+        pthread_join (readers[i], NULL);
+    }
+
+    ck_assert_int_eq (shared.errors, 0);
+    ck_assert_int_eq (rb_sync_size (shared.tree), KEYS / 2);
+
+    rb_sync_delete (shared.tree);
+}
+END_TEST
+
+int main (void)
+{
+    Suite* s = suite_create ("rbsync");
+    TCase* core = tcase_create ("core");
+
+    suite_add_tcase (s, core);
+    tcase_set_timeout (core, 30);
+    tcase_add_test (core, test_rb_sync_new);
+    tcase_add_test (core, test_rb_sync_iter);
+    tcase_add_test (core, test_rb_sync_reenter);
+    tcase_add_test (core, test_rb_sync_owner);
+    tcase_add_test (core, test_rb_sync_nested);
+    tcase_add_test (core, test_rb_sync_stress);
+
+    SRunner* runner = srunner_create (s);
+    srunner_set_fork_status (runner, CK_NOFORK);
+    srunner_run_all (runner, CK_ENV);
+    int nf = srunner_ntests_failed (runner);
+    srunner_free (runner);
+
+    return nf == 0 ? 0 : 1;
+}
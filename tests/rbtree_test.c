@@ -28,6 +28,9 @@
 // libraries.
 #include <check.h>
 
+// C.
+#include <stdlib.h>
+
 int compare (const void* left, const void* right)
 {
     return (*(int*)(left) == *(int*)(right)) ? 0 : ((*(int*)(left) < *(int*)(right)) ? -1 : 1);
@@ -43,6 +46,143 @@ START_TEST (test_rb_new)
 }
 END_TEST
 
+struct counter
+{
+    int allocs;
+    int frees;
+};
+
+void* count_alloc (size_t size, void* ctx)
+{
+    ((struct counter*)ctx)->allocs++;
+    return malloc (size);
+}
+
+void count_free (void* ptr, void* ctx)
+{
+    ((struct counter*)ctx)->frees++;
+    free (ptr);
+}
+
+START_TEST (test_rb_node)
+{
+    struct rbnode node = { { NULL, NULL }, 0 };
+    struct rbnode parent = { { &node, NULL }, 0 };
+
+    /* color is packed in the parent pointer */
+    ck_assert_uint_eq (sizeof (struct rbnode), 3 * sizeof (void*));
+    ck_assert_uint_eq (sizeof (struct rbelem), 4 * sizeof (void*));
+
+    rb_set_red (&node, 1);
+    rb_set_parent (&node, &parent);
+    ck_assert_ptr_eq (rb_parent (&node), &parent);
+    ck_assert_int_eq (rb_red (&node), 1);
+
+    rb_set_red (&node, 0);
+    ck_assert_ptr_eq (rb_parent (&node), &parent);
+    ck_assert_int_eq (rb_red (&node), 0);
+
+    rb_set_parent (&node, NULL);
+    ck_assert_ptr_eq (rb_parent (&node), NULL);
+    ck_assert_int_eq (rb_red (&node), 0);
+}
+END_TEST
+
+START_TEST (test_rb_new_ex)
+{
+    int val1 = 1, val2 = 2, val3 = 3;
+    struct counter counter = { 0 };
+    struct rballoc alloc = { count_alloc, count_free, NULL, &counter };
+    struct rbtree* tree = rb_new_ex (compare, NULL, 0, &alloc);
+
+    ck_assert_ptr_ne (tree, NULL);
+
+    /* insert nodes */
+    ck_assert_ptr_eq (rb_insert (&val1, tree), &val1);
+    ck_assert_ptr_eq (rb_insert (&val2, tree), &val2);
+    ck_assert_ptr_eq (rb_insert (&val3, tree), &val3);
+
+    /* check allocations */
+    ck_assert_int_eq (counter.allocs, 3);
+    ck_assert_int_eq (counter.frees, 0);
+
+    /* remove node */
+    rb_remove (&val2, tree);
+    ck_assert_int_eq (counter.frees, 1);
+
+    rb_delete (tree);
+
+    /* check deallocations */
+    ck_assert_int_eq (counter.frees, 3);
+
+    /* allocator without free function */
+    alloc.free = NULL;
+    ck_assert_ptr_eq (rb_new_ex (compare, NULL, 0, &alloc), NULL);
+}
+END_TEST
+
+struct record
+{
+    int            key;
+    struct rbnode  node;
+};
+
+int compare_node (const void* left, const void* right)
+{
+    return compare (&rb_entry (left, struct record, node)->key, &rb_entry (right, struct record, node)->key);
+}
+
+int removed = 0;
+
+void remove_node (void* node)
+{
+    rb_entry (node, struct record, node)->key = -1;
+    ++removed;
+}
+
+START_TEST (test_rb_intrusive)
+{
+    struct record rec[5] = { { .key = 1 }, { .key = 2 }, { .key = 3 }, { .key = 4 }, { .key = 5 } };
+    struct record key = { .key = 3 };
+    struct counter counter = { 0 };
+    struct rballoc alloc = { count_alloc, count_free, NULL, &counter };
+    struct rbtree* tree = rb_new_ex (compare_node, remove_node, RB_INTRUSIVE, &alloc);
+
+    ck_assert_ptr_ne (tree, NULL);
+
+    /* insert nodes */
+    for (int i = 0; i < 5; ++i)
+    {
+        ck_assert_ptr_eq (rb_insert (&rec[i].node, tree), &rec[i].node);
+    }
+
+    /* try to insert nodes again */
+    ck_assert_ptr_eq (rb_insert (&key.node, tree), NULL);
+
+    /* find nodes */
+    ck_assert_ptr_eq (rb_find (&key.node, tree), &rec[2].node);
+    ck_assert_int_eq (rb_entry (rb_find (&key.node, tree), struct record, node)->key, 3);
+
+    /* remove nodes */
+    rb_remove (&key.node, tree);
+    ck_assert_ptr_eq (rb_find (&key.node, tree), NULL);
+    ck_assert_int_eq (rec[2].key, -1);
+    ck_assert_int_eq (removed, 1);
+    ck_assert_int_eq (rb_size (tree), 4);
+
+    /* remaining nodes are still found */
+    ck_assert_ptr_eq (rb_find (&rec[0].node, tree), &rec[0].node);
+    ck_assert_ptr_eq (rb_find (&rec[4].node, tree), &rec[4].node);
+
+    rb_delete (tree);
+
+    /* nodes are never allocated */
+    ck_assert_int_eq (counter.allocs, 0);
+    ck_assert_int_eq (counter.frees, 0);
+    ck_assert_int_eq (removed, 5);
+}
+END_TEST
+
 START_TEST (test_rb_insert)
 {
     int val1 = 1, val2 = 2, val3 = 3, val4 = 4, val5 = 5;
@@ -66,6 +206,84 @@ START_TEST (test_rb_insert)
 }
 END_TEST
 
+START_TEST (test_rb_build_sorted)
+{
+    int vals[7] = { 1, 2, 2, 3, 4, 5, 6 };
+    void* items[7];
+    struct rbtree* tree = rb_new (compare, NULL);
+
+    for (int i = 0; i < 7; ++i)
+    {
+        items[i] = &vals[i];
+    }
+
+    /* build the tree, duplicates are rejected */
+    ck_assert_int_eq (rb_build_sorted (items, 7, tree), 6);
+    ck_assert_int_eq (rb_size (tree), 6);
+    ck_assert_ptr_eq (items[6], &vals[2]);
+
+    /* the tree is not empty anymore */
+    ck_assert_int_eq (rb_build_sorted (items, 6, tree), 0);
+
+    /* find nodes */
+    for (int i = 0; i < 7; ++i)
+    {
+        ck_assert_int_eq (*(int*)rb_find (&vals[i], tree), vals[i]);
+    }
+
+    /* the tree is still usable */
+    rb_remove (&vals[0], tree);
+    rb_remove (&vals[3], tree);
+    ck_assert_ptr_eq (rb_find (&vals[0], tree), NULL);
+    ck_assert_ptr_eq (rb_insert (&vals[0], tree), &vals[0]);
+    ck_assert_int_eq (rb_size (tree), 5);
+
+    rb_delete (tree);
+
+    /* unsorted items are refused and left untouched, even after duplicates */
+    tree = rb_new (compare, NULL);
+    for (int i = 0; i < 7; ++i)
+    {
+        items[i] = &vals[i];
+    }
+    items[5] = &vals[0];
+    ck_assert_int_eq (rb_build_sorted (items, 7, tree), 0);
+    ck_assert (rb_empty (tree));
+    for (int i = 0; i < 7; ++i)
+    {
+        ck_assert_ptr_eq (items[i], (i == 5) ? &vals[0] : &vals[i]);
+    }
+
+    rb_delete (tree);
+}
+END_TEST
+
+START_TEST (test_rb_build)
+{
+    int vals[1000];
+    void* items[1000];
+    struct rbtree* tree = rb_new (compare, NULL);
+
+    for (int i = 0; i < 1000; ++i)
+    {
+        vals[i] = (i * 7919) % 500;
+        items[i] = &vals[i];
+    }
+
+    /* build the tree from unsorted items */
+    ck_assert_int_eq (rb_build (items, 1000, tree), 500);
+    ck_assert_int_eq (rb_size (tree), 500);
+
+    /* the first of equal elements is inserted */
+    for (int i = 0; i < 500; ++i)
+    {
+        ck_assert_ptr_eq (rb_find (&vals[i], tree), &vals[i]);
+    }
+
+    rb_delete (tree);
+}
+END_TEST
+
 START_TEST (test_rb_find)
 {
     int val1 = 1, val2 = 2, val3 = 3, val4 = 4, val5 = 5;
@@ -117,6 +335,238 @@ START_TEST (test_rb_find)
 }
 END_TEST
 
+START_TEST (test_rb_bound)
+{
+    int val1 = 1, val3 = 3, val5 = 5, key;
+    struct rbtree* tree = rb_new (compare, NULL);
+
+    /* empty tree */
+    key = 3;
+    ck_assert_ptr_eq (rb_lower_bound (&key, tree), NULL);
+    ck_assert_ptr_eq (rb_upper_bound (&key, tree), NULL);
+
+    /* insert nodes */
+    ck_assert_ptr_eq (rb_insert (&val1, tree), &val1);
+    ck_assert_ptr_eq (rb_insert (&val3, tree), &val3);
+    ck_assert_ptr_eq (rb_insert (&val5, tree), &val5);
+
+    /* check bounds */
+    key = 0;
+    ck_assert_ptr_eq (rb_lower_bound (&key, tree), &val1);
+    ck_assert_ptr_eq (rb_upper_bound (&key, tree), &val1);
+    key = 3;
+    ck_assert_ptr_eq (rb_lower_bound (&key, tree), &val3);
+    ck_assert_ptr_eq (rb_upper_bound (&key, tree), &val5);
+    key = 4;
+    ck_assert_ptr_eq (rb_lower_bound (&key, tree), &val5);
+    ck_assert_ptr_eq (rb_upper_bound (&key, tree), &val5);
+    key = 5;
+    ck_assert_ptr_eq (rb_lower_bound (&key, tree), &val5);
+    ck_assert_ptr_eq (rb_upper_bound (&key, tree), NULL);
+
+    rb_delete (tree);
+}
+END_TEST
+
+int sum (void* data, void* ctx)
+{
+    *(int*)ctx += *(int*)data;
+    return *(int*)ctx >= 100;
+}
+
+START_TEST (test_rb_range)
+{
+    int vals[20], lo = 5, hi = 10, from = 15, total = 0;
+    struct rbtree* tree = rb_new (compare, NULL);
+
+    /* insert nodes */
+    for (int i = 0; i < 20; ++i)
+    {
+        vals[i] = i;
+        ck_assert_ptr_eq (rb_insert (&vals[i], tree), &vals[i]);
+    }
+
+    /* visit [5, 10) */
+    ck_assert_int_eq (rb_range (&lo, &hi, sum, &total, tree), 5);
+    ck_assert_int_eq (total, 5 + 6 + 7 + 8 + 9);
+
+    /* visit up to the end */
+    total = 0;
+    ck_assert_int_eq (rb_range (&from, NULL, sum, &total, tree), 5);
+    ck_assert_int_eq (total, 15 + 16 + 17 + 18 + 19);
+
+    /* visit from the beginning and stop early */
+    total = 0;
+    ck_assert_int_eq (rb_range (NULL, NULL, sum, &total, tree), 15);
+    ck_assert_int_eq (total, 105);
+
+    /* empty range */
+    total = 0;
+    ck_assert_int_eq (rb_range (&hi, &lo, sum, &total, tree), 0);
+    ck_assert_int_eq (total, 0);
+
+    rb_delete (tree);
+}
+END_TEST
+
+START_TEST (test_rb_rank)
+{
+    int vals[100], key;
+    struct rbtree* tree = rb_new_ex (compare, NULL, RB_RANK, NULL);
+    struct rbtree* plain = rb_new (compare, NULL);
+
+    ck_assert_ptr_ne (tree, NULL);
+
+    /* order statistics are not available for intrusive trees */
+    ck_assert_ptr_eq (rb_new_ex (compare, NULL, RB_RANK | RB_INTRUSIVE, NULL), NULL);
+
+    /* insert even values in scattered order */
+    for (int i = 0; i < 100; ++i)
+    {
+        vals[i] = ((i * 37) % 100) * 2;
+        ck_assert_ptr_eq (rb_insert (&vals[i], tree), &vals[i]);
+        ck_assert_ptr_eq (rb_insert (&vals[i], plain), &vals[i]);
+    }
+
+    /* check ranks */
+    for (int i = 0; i < 100; ++i)
+    {
+        key = 2 * i;
+        ck_assert_int_eq (*(int*)rb_select (i, tree), key);
+        ck_assert_int_eq (*(int*)rb_select (i, plain), key);
+        ck_assert_int_eq (rb_rank (&key, tree), i);
+        ck_assert_int_eq (rb_rank (&key, plain), i);
+        key = 2 * i + 1;
+        ck_assert_int_eq (rb_rank (&key, tree), i + 1);
+    }
+    ck_assert_ptr_eq (rb_select (100, tree), NULL);
+
+    /* remove values below 100 */
+    for (int i = 0; i < 100; ++i)
+    {
+        if (vals[i] < 100)
+            rb_remove (&vals[i], tree);
+    }
+
+    /* check ranks again */
+    ck_assert_int_eq (rb_size (tree), 50);
+    for (int i = 0; i < 50; ++i)
+    {
+        key = 100 + 2 * i;
+        ck_assert_int_eq (*(int*)rb_select (i, tree), key);
+        ck_assert_int_eq (rb_rank (&key, tree), i);
+    }
+
+    rb_delete (plain);
+    rb_delete (tree);
+}
+END_TEST
+
+struct item
+{
+    int            key;
+    int            sum;
+    struct rbnode  node;
+};
+
+int compare_item (const void* left, const void* right)
+{
+    return compare (&rb_entry (left, struct item, node)->key, &rb_entry (right, struct item, node)->key);
+}
+
+void propagate_sum (struct rbnode* node, struct rbtree* tree)
+{
+    struct item* item = rb_entry (node, struct item, node);
+
+    (void) tree;
+    item->sum = item->key;
+    if (node->link[0] != NULL)
+        item->sum += rb_entry (node->link[0], struct item, node)->sum;
+    if (node->link[1] != NULL)
+        item->sum += rb_entry (node->link[1], struct item, node)->sum;
+}
+
+START_TEST (test_rb_augment)
+{
+    struct item items[64];
+    struct rbtree* tree = rb_new_ex (compare_item, NULL, RB_INTRUSIVE, NULL);
+    int total = 0;
+
+    ck_assert_int_eq (rb_set_augment (propagate_sum, tree), 0);
+
+    /* insert items */
+    for (int i = 0; i < 64; ++i)
+    {
+        items[i].key = (i * 13) % 64;
+        ck_assert_ptr_eq (rb_insert (&items[i].node, tree), &items[i].node);
+        total += items[i].key;
+        ck_assert_int_eq (rb_entry (tree->root, struct item, node)->sum, total);
+    }
+
+    /* the tree is not empty anymore */
+    ck_assert_int_eq (rb_set_augment (NULL, tree), -1);
+
+    /* remove items */
+    for (int i = 0; i < 64; i += 2)
+    {
+        rb_remove (&items[i].node, tree);
+        total -= items[i].key;
+        ck_assert_int_eq (rb_entry (tree->root, struct item, node)->sum, total);
+    }
+
+    rb_delete (tree);
+}
+END_TEST
+
+START_TEST (test_rb_batch)
+{
+    int vals[100];
+    void* items[100];
+    const void* keys[100];
+    void* found[100];
+    void* inserted[100];
+    struct rbtree* tree = rb_new (compare, NULL);
+
+    for (int i = 0; i < 100; ++i)
+    {
+        vals[i] = i;
+        items[i] = &vals[i];
+        keys[i] = &vals[i];
+    }
+
+    /* insert even values */
+    ck_assert_int_eq (rb_insert_batch (items, NULL, 50, tree), 50);
+    ck_assert_int_eq (rb_insert_batch (items, inserted, 100, tree), 50);
+    for (int i = 0; i < 100; ++i)
+    {
+        ck_assert_ptr_eq (inserted[i], i < 50 ? NULL : &vals[i]);
+    }
+
+    /* remove odd values */
+    for (int i = 0; i < 50; ++i)
+    {
+        keys[i] = &vals[2 * i + 1];
+    }
+    ck_assert_int_eq (rb_remove_batch (keys, 50, tree), 50);
+    ck_assert_int_eq (rb_remove_batch (keys, 50, tree), 0);
+    ck_assert_int_eq (rb_size (tree), 50);
+
+    /* find all values, results match rb_find */
+    for (int i = 0; i < 100; ++i)
+    {
+        keys[i] = &vals[i];
+    }
+    ck_assert_int_eq (rb_find_batch (keys, found, 100, tree), 50);
+    for (int i = 0; i < 100; ++i)
+    {
+        ck_assert_ptr_eq (found[i], rb_find (&vals[i], tree));
+        ck_assert_ptr_eq (found[i], i % 2 ? NULL : &vals[i]);
+    }
+
+    rb_delete (tree);
+}
+END_TEST
+
 START_TEST (test_rb_remove)
 {
     int val1 = 1, val2 = 2, val3 = 3, val4 = 4, val5 = 5;
@@ -149,6 +599,525 @@ START_TEST (test_rb_remove)
 }
 END_TEST
 
+START_TEST (test_rb_join)
+{
+    int vals[200], key = 99;
+    struct rbtree* tree = rb_new_ex (compare, NULL, RB_RANK, NULL);
+    struct rbtree* right = rb_new_ex (compare, NULL, RB_RANK, NULL);
+    struct rbtree* plain = rb_new (compare, NULL);
+
+    for (int i = 0; i < 200; ++i)
+    {
+        vals[i] = i;
+        rb_insert (&vals[i], (i < 150) ? tree : right);
+    }
+
+    /* trees must be compatible and ordered */
+    ck_assert_int_eq (rb_join (plain, tree), -1);
+    ck_assert_int_eq (rb_join (tree, right), -1);
+    ck_assert_int_eq (rb_join (right, tree), 0);
+    ck_assert_int_eq (rb_size (tree), 200);
+    ck_assert_int_eq (rb_size (right), 0);
+
+    /* split keeps the equal element on the left */
+    ck_assert_int_eq (rb_split (&key, plain, tree), -1);
+    ck_assert_int_eq (rb_split (&key, right, tree), 0);
+    ck_assert_int_eq (rb_size (tree), 100);
+    ck_assert_int_eq (rb_size (right), 100);
+    ck_assert_int_eq (rb_split (&key, right, tree), -1);
+
+    for (int i = 0; i < 100; ++i)
+    {
+        ck_assert_int_eq (*(int*)rb_select (i, tree), i);
+        ck_assert_int_eq (*(int*)rb_select (i, right), 100 + i);
+    }
+
+    ck_assert_int_eq (rb_join (right, tree), 0);
+    ck_assert_int_eq (rb_rank (&key, tree), 99);
+    ck_assert_int_eq (*(int*)rb_select (199, tree), 199);
+
+    rb_delete (plain);
+    rb_delete (right);
+    rb_delete (tree);
+}
+END_TEST
+
+int deleted = 0;
+
+void count_delete (void* data)
+{
+    (void) data;
+    ++deleted;
+}
+
+START_TEST (test_rb_set)
+{
+    int a[3000], b[3000];
+    struct rbtree* tree = rb_new (compare, count_delete);
+    struct rbtree* other = rb_new (compare, count_delete);
+
+    /* multiples of 2 against multiples of 3 */
+    for (int i = 0; i < 3000; ++i)
+    {
+        a[i] = b[i] = i;
+        if (i % 2 == 0)
+            rb_insert (&a[i], tree);
+        if (i % 3 == 0)
+            rb_insert (&b[i], other);
+    }
+
+    ck_assert_int_eq (rb_union (other, tree), 0);
+    ck_assert_int_eq (rb_size (tree), 2000);
+    ck_assert_int_eq (rb_size (other), 0);
+    ck_assert_int_eq (deleted, 500);
+
+    /* elements of the tree win over equal ones of the other */
+    int key = 6;
+    ck_assert_ptr_eq (rb_find (&key, tree), &a[6]);
+    key = 3;
+    ck_assert_ptr_eq (rb_find (&key, tree), &b[3]);
+
+    /* intersect with multiples of 5 */
+    for (int i = 0; i < 3000; i += 5)
+        rb_insert (&b[i], other);
+
+    deleted = 0;
+    ck_assert_int_eq (rb_intersect (other, tree), 0);
+    ck_assert_int_eq (rb_size (tree), 400);
+    ck_assert_int_eq (deleted, 2000 - 400 + 600);
+
+    for (int i = 0; i < 3000; ++i)
+    {
+        int in = (i % 5 == 0) && (i % 2 == 0 || i % 3 == 0);
+        ck_assert_int_eq (rb_find (&i, tree) != NULL, in);
+    }
+
+    /* remove multiples of 4 */
+    for (int i = 0; i < 3000; i += 4)
+        rb_insert (&b[i], other);
+
+    ck_assert_int_eq (rb_difference (other, tree), 0);
+    ck_assert_int_eq (rb_size (tree), 250);
+
+    for (int i = 0; i < 3000; ++i)
+    {
+        int in = (i % 5 == 0) && (i % 2 == 0 || i % 3 == 0) && (i % 4 != 0);
+        ck_assert_int_eq (rb_find (&i, tree) != NULL, in);
+    }
+
+    rb_delete (other);
+    rb_delete (tree);
+}
+END_TEST
+
+START_TEST (test_rb_map)
+{
+    int keys[100], vals[100], other = -1;
+    struct rbtree* tree = rb_new_ex (compare, count_delete, RB_MAP | RB_RANK, NULL);
+    int inserted;
+
+    ck_assert_ptr_eq (rb_new_ex (compare, NULL, RB_MAP | RB_INTRUSIVE, NULL), NULL);
+    ck_assert_int_eq (rb_set_value_destroy (count_delete, tree), 0);
+
+    for (int i = 0; i < 100; ++i)
+    {
+        keys[i] = (i * 37) % 100;
+        vals[i] = i;
+    }
+
+    /* plain trees are not maps */
+    struct rbtree* plain = rb_new (compare, NULL);
+    ck_assert_int_eq (rb_set_value_destroy (count_delete, plain), -1);
+    ck_assert_ptr_eq (rb_put (&keys[0], &vals[0], plain), NULL);
+    ck_assert_ptr_eq (rb_get (&keys[0], plain), NULL);
+    rb_delete (plain);
+
+    /* insert, then assign */
+    for (int i = 0; i < 100; ++i)
+    {
+        ck_assert_ptr_eq (rb_put (&keys[i], &vals[i], tree), &keys[i]);
+    }
+    ck_assert_int_eq (rb_size (tree), 100);
+
+    deleted = 0;
+    int dup = keys[10];
+    ck_assert_ptr_eq (rb_put (&dup, &other, tree), &keys[10]);
+    ck_assert_int_eq (deleted, 1);
+    ck_assert_ptr_eq (rb_get (&keys[10], tree), &other);
+    ck_assert_int_eq (rb_size (tree), 100);
+
+    /* values follow their keys through rotations */
+    for (int i = 0; i < 100; ++i)
+    {
+        ck_assert_ptr_eq (rb_get (&keys[i], tree), (i == 10) ? &other : &vals[i]);
+        ck_assert_int_eq (*(int*)rb_select ((size_t)keys[i], tree), keys[i]);
+    }
+
+    /* slots of existing and new keys */
+    int key = 1000;
+    void** slot = rb_get_or_insert (&keys[5], &inserted, tree);
+    ck_assert_int_eq (inserted, 0);
+    ck_assert_ptr_eq (*slot, &vals[5]);
+    slot = rb_get_or_insert (&key, &inserted, tree);
+    ck_assert_int_eq (inserted, 1);
+    ck_assert_ptr_eq (*slot, NULL);
+    *slot = &vals[0];
+    ck_assert_ptr_eq (rb_get (&key, tree), &vals[0]);
+    ck_assert_ptr_eq (rb_get_or_insert (&key, NULL, tree), slot);
+
+    /* take hands back the key and value without deleting them */
+    void* value = NULL;
+    deleted = 0;
+    ck_assert_ptr_eq (rb_take (&key, &value, tree), &key);
+    ck_assert_ptr_eq (value, &vals[0]);
+    ck_assert_int_eq (deleted, 0);
+    ck_assert_ptr_eq (rb_take (&key, &value, tree), NULL);
+
+    for (int i = 0; i < 50; ++i)
+    {
+        ck_assert_ptr_eq (rb_take (&i, &value, tree), &keys[(i * 73) % 100]);
+        ck_assert_int_eq (*(int*)value, (i == keys[10]) ? -1 : (i * 73) % 100);
+    }
+    ck_assert_int_eq (deleted, 0);
+    ck_assert_int_eq (rb_size (tree), 50);
+
+    /* remove and delete destroy keys and values */
+    key = 50;
+    rb_remove (&key, tree);
+    ck_assert_int_eq (deleted, 2);
+    rb_delete (tree);
+    ck_assert_int_eq (deleted, 100);
+}
+END_TEST
+
+START_TEST (test_rb_multi)
+{
+    struct record
+    {
+        int key;
+        int seq;
+    } recs[300];
+
+    for (int flags = RB_MULTI; flags <= (RB_MULTI | RB_RANK); flags += RB_RANK)
+    {
+        struct rbtree* tree = rb_new_ex (compare, NULL, flags, NULL);
+
+        /* 30 keys, 10 of each, all kept */
+        for (int i = 0; i < 300; ++i)
+        {
+            recs[i].key = (i * 7) % 30;
+            recs[i].seq = i;
+            ck_assert_ptr_eq (rb_insert (&recs[i], tree), &recs[i]);
+        }
+        ck_assert_int_eq (rb_size (tree), 300);
+
+        for (int key = -1; key <= 30; ++key)
+        {
+            ck_assert_int_eq (rb_count_key (&key, tree), (key >= 0 && key < 30) ? 10 : 0);
+        }
+
+        /* finds and removals reach the oldest of equal elements */
+        int key = 7;
+        struct record* found = rb_find (&key, tree);
+        ck_assert_int_eq (found->seq, 1);
+        ck_assert_ptr_eq (rb_lower_bound (&key, tree), found);
+        rb_remove (&key, tree);
+        ck_assert_int_eq (((struct record*)rb_find (&key, tree))->seq, 31);
+        ck_assert_int_eq (rb_count_key (&key, tree), 9);
+        ck_assert_int_eq (rb_rank (&key, tree), 70);
+
+        /* batched finds agree with rb_find */
+        int keys[32];
+        const void* batch[32];
+        void* results[32];
+        for (int i = 0; i < 32; ++i)
+        {
+            keys[i] = i - 1;
+            batch[i] = &keys[i];
+        }
+        ck_assert_int_eq (rb_find_batch (batch, results, 32, tree), 30);
+        for (int i = 0; i < 32; ++i)
+            ck_assert_ptr_eq (results[i], rb_find (&keys[i], tree));
+
+        /* splits keep all equal elements on the left */
+        struct rbtree* right = rb_new_ex (compare, NULL, flags, NULL);
+        key = 2;
+        ck_assert_int_eq (rb_split (&key, right, tree), 0);
+        ck_assert_int_eq (rb_size (tree), 30);
+        ck_assert_int_eq (rb_size (right), 269);
+        ck_assert_int_eq (rb_count_key (&key, tree), 10);
+        ck_assert_int_eq (rb_count_key (&key, right), 0);
+        ck_assert_int_eq (((struct record*)rb_last (tree))->key, 2);
+        ck_assert_int_eq (((struct record*)rb_first (right))->key, 3);
+        ck_assert_int_eq (((struct record*)rb_find (&key, tree))->seq, 26);
+
+        ck_assert_int_eq (rb_join (right, tree), 0);
+        ck_assert_int_eq (rb_size (tree), 299);
+        ck_assert_int_eq (rb_count_key (&key, tree), 10);
+
+        rb_delete (right);
+        rb_delete (tree);
+    }
+
+    /* sorted builds keep equal neighbours */
+    int vals[6] = { 1, 2, 2, 2, 3, 3 };
+    void* items[6];
+    for (int i = 0; i < 6; ++i)
+        items[i] = &vals[i];
+
+    struct rbtree* tree = rb_new_ex (compare, NULL, RB_MULTI, NULL);
+    ck_assert_int_eq (rb_build_sorted (items, 6, tree), 6);
+    ck_assert_ptr_eq (rb_find (&vals[1], tree), &vals[1]);
+    ck_assert_int_eq (rb_count_key (&vals[1], tree), 3);
+
+    /* set operations need unique elements */
+    struct rbtree* other = rb_new_ex (compare, NULL, RB_MULTI, NULL);
+    ck_assert_int_eq (rb_union (other, tree), -1);
+
+    rb_delete (other);
+    rb_delete (tree);
+}
+END_TEST
+
+START_TEST (test_rb_pop)
+{
+    int vals[500];
+    void* items[500];
+    struct rbtree* tree = rb_new_ex (compare, NULL, RB_RANK, NULL);
+
+    ck_assert_ptr_eq (rb_first (tree), NULL);
+    ck_assert_ptr_eq (rb_last (tree), NULL);
+    ck_assert_ptr_eq (rb_pop_first (tree), NULL);
+    ck_assert_ptr_eq (rb_pop_last (tree), NULL);
+
+    for (int i = 0; i < 500; ++i)
+    {
+        vals[i] = (i * 7919) % 500;
+        rb_insert (&vals[i], tree);
+    }
+
+    /* pop from both ends, the cached ends follow insertions and removals */
+    for (int i = 0; i < 100; ++i)
+    {
+        ck_assert_int_eq (*(int*)rb_first (tree), i);
+        ck_assert_int_eq (*(int*)rb_pop_first (tree), i);
+        ck_assert_int_eq (*(int*)rb_last (tree), 499 - i);
+        ck_assert_int_eq (*(int*)rb_pop_last (tree), 499 - i);
+        ck_assert_int_eq (*(int*)rb_select (0, tree), i + 1);
+    }
+    ck_assert_int_eq (rb_size (tree), 300);
+
+    rb_remove (&(int){ 100 }, tree);
+    ck_assert_int_eq (*(int*)rb_first (tree), 101);
+    rb_insert (&vals[0], tree);
+    ck_assert_int_eq (*(int*)rb_first (tree), 0);
+
+    /* split and join recompute them */
+    struct rbtree* right = rb_new_ex (compare, NULL, RB_RANK, NULL);
+    ck_assert_int_eq (rb_split (&(int){ 250 }, right, tree), 0);
+    ck_assert_int_eq (*(int*)rb_last (tree), 250);
+    ck_assert_int_eq (*(int*)rb_first (right), 251);
+    ck_assert_int_eq (*(int*)rb_last (right), 399);
+    ck_assert_int_eq (rb_join (right, tree), 0);
+    ck_assert_int_eq (*(int*)rb_last (tree), 399);
+    ck_assert_ptr_eq (rb_first (right), NULL);
+
+    /* drain */
+    int prev = -1;
+    for (int* data = rb_pop_first (tree); data != NULL; data = rb_pop_first (tree))
+    {
+        ck_assert_int_gt (*data, prev);
+        prev = *data;
+    }
+    ck_assert (rb_empty (tree));
+    ck_assert_ptr_eq (rb_last (tree), NULL);
+
+    /* bulk builds */
+    for (int i = 0; i < 500; ++i)
+        items[i] = &vals[i];
+    ck_assert_int_eq (rb_build (items, 500, tree), 500);
+    ck_assert_int_eq (*(int*)rb_first (tree), 0);
+    ck_assert_int_eq (*(int*)rb_last (tree), 499);
+
+    rb_delete (right);
+    rb_delete (tree);
+}
+END_TEST
+
+void* limit_alloc (size_t size, void* ctx)
+{
+    int* left = ctx;
+
+    return (*left)-- > 0 ? malloc (size) : NULL;
+}
+
+void limit_free (void* ptr, void* ctx)
+{
+    (void) ctx;
+    free (ptr);
+}
+
+START_TEST (test_rb_topdown)
+{
+    int vals[2000];
+    struct rbtree* down = rb_new_ex (compare, NULL, RB_TOPDOWN | RB_RANK, NULL);
+    struct rbtree* up = rb_new_ex (compare, NULL, RB_RANK, NULL);
+    struct rbstats sd, su;
+
+    for (int i = 0; i < 2000; ++i)
+    {
+        vals[i] = (i * 7919) % 2000;
+    }
+
+    /* both balancing strategies agree on contents */
+    for (int i = 0; i < 2000; ++i)
+    {
+        ck_assert_ptr_eq (rb_insert (&vals[i], down), &vals[i]);
+        ck_assert_ptr_eq (rb_insert (&vals[i], up), &vals[i]);
+        ck_assert_ptr_eq (rb_insert (&vals[i], up), NULL);
+    }
+    for (int i = 0; i < 2000; i += 3)
+    {
+        rb_remove (&vals[i], down);
+        rb_remove (&vals[i], up);
+    }
+
+    ck_assert_int_eq (rb_size (down), rb_size (up));
+    for (size_t k = 0; k < rb_size (up); ++k)
+    {
+        ck_assert_ptr_eq (rb_select (k, down), rb_select (k, up));
+    }
+    ck_assert_ptr_eq (rb_first (up), rb_first (down));
+    ck_assert_ptr_eq (rb_last (up), rb_last (down));
+
+    /* trees only differing by strategy can be joined */
+    struct rbtree* right = rb_new_ex (compare, NULL, RB_RANK, NULL);
+    ck_assert_int_eq (rb_split (&(int){ 999 }, right, down), 0);
+    ck_assert_int_eq (rb_join (right, down), 0);
+    ck_assert_int_eq (rb_size (down), rb_size (up));
+
+#ifdef RB_STATS
+    /* bottom-up fix-ups rotate less */
+    ck_assert_int_eq (rb_stats (down, &sd), 0);
+    ck_assert_int_eq (rb_stats (up, &su), 0);
+    ck_assert_int_lt (su.rotations, sd.rotations);
+#else
+    ck_assert_int_eq (rb_stats (down, &sd), -1);
+    ck_assert_int_eq (rb_stats (up, &su), -1);
+#endif
+
+    rb_delete (right);
+    rb_delete (down);
+    rb_delete (up);
+
+    /* a failed allocation keeps the rotations done on the way down */
+    for (int n = 1; n < 200; ++n)
+    {
+        int left = n;
+        struct rballoc alloc = { limit_alloc, limit_free, NULL, &left };
+        struct rbtree* tree = rb_new_ex (compare, NULL, RB_TOPDOWN, &alloc);
+
+        for (int i = 0; i < 200; ++i)
+        {
+            vals[i] = i;
+            ck_assert_ptr_eq (rb_insert (&vals[i], tree), (i < n) ? &vals[i] : NULL);
+        }
+
+        ck_assert_int_eq (rb_size (tree), n);
+        for (int i = 0; i < n; ++i)
+        {
+            ck_assert_ptr_eq (rb_find (&vals[i], tree), &vals[i]);
+        }
+
+        rb_delete (tree);
+    }
+}
+END_TEST
+
+START_TEST (test_rb_stats)
+{
+    int vals[64];
+    struct rbtree* tree = rb_new (compare, NULL);
+    struct rbstats stats;
+
+    for (int i = 0; i < 64; ++i)
+    {
+        vals[i] = i;
+        rb_insert (&vals[i], tree);
+    }
+
+#ifdef RB_STATS
+    ck_assert_int_eq (rb_stats (tree, &stats), 0);
+    ck_assert_int_eq (stats.allocs, 64);
+    ck_assert_int_gt (stats.rotations, 0);
+    ck_assert_int_gt (stats.recolors, 0);
+    ck_assert_int_eq (stats.descents, 63);
+    ck_assert_int_le (stats.depth_max, 12);
+    ck_assert_int_ge (stats.compares, stats.depth_sum);
+
+    rb_stats_reset (tree);
+    ck_assert_ptr_eq (rb_find (&vals[0], tree), &vals[0]);
+    rb_remove (&vals[0], tree);
+    ck_assert_int_eq (rb_stats (tree, &stats), 0);
+    ck_assert_int_eq (stats.descents, 2);
+    ck_assert_int_eq (stats.frees, 1);
+    ck_assert_int_eq (stats.depth_sum, stats.compares);
+
+    /* batched lookups account for one descent per key, like rb_find */
+    const void* batch[] = {&vals[0], &vals[10], &vals[40]};
+    void* results[3];
+    struct rbstats single;
+
+    rb_stats_reset (tree);
+    for (int i = 0; i < 3; ++i)
+    {
+        rb_find (batch[i], tree);
+    }
+    ck_assert_int_eq (rb_stats (tree, &single), 0);
+
+    rb_stats_reset (tree);
+    ck_assert_int_eq (rb_find_batch (batch, results, 3, tree), 2);
+    ck_assert_int_eq (rb_stats (tree, &stats), 0);
+    ck_assert_int_eq (stats.descents, 3);
+    ck_assert_int_eq (stats.depth_sum, single.depth_sum);
+    ck_assert_int_eq (stats.depth_max, single.depth_max);
+    ck_assert_int_eq (stats.depth_sum, stats.compares);
+
+    /* set operations run joins in several threads and leave counters alone */
+    enum { N = 1 << 18 };
+    int* keys = malloc (2 * N * sizeof (int));
+    struct rbtree* other = rb_new (compare, NULL);
+
+    ck_assert_ptr_ne (keys, NULL);
+    rb_remove (&vals[63], tree);
+    for (int i = 0; i < 2 * N; ++i)
+    {
+        keys[i] = 64 + i;
+        rb_insert (&keys[i], (i % 2) ? other : tree);
+    }
+
+    rb_stats_reset (tree);
+    ck_assert_int_eq (rb_union (other, tree), 0);
+    ck_assert_int_eq (rb_size (tree), 2 * N + 62);
+    ck_assert_int_eq (rb_stats (tree, &stats), 0);
+    ck_assert_int_eq (stats.rotations, 0);
+    ck_assert_int_eq (stats.compares, 0);
+
+    rb_delete (other);
+    rb_delete (tree);
+    tree = rb_new (compare, NULL);
+    free (keys);
+#else
+    /* counters compile away */
+    ck_assert_int_eq (rb_stats (tree, &stats), -1);
+    ck_assert_int_eq (stats.compares, 0);
+    rb_stats_reset (tree);
+#endif
+
+    rb_delete (tree);
+}
+END_TEST
+
 START_TEST (test_rb_size)
 {
     int val1 = 1, val2 = 2, val3 = 3, val4 = 4, val5 = 5;
@@ -222,9 +1191,26 @@ int main (void)
 
     suite_add_tcase (s, core);
     tcase_add_test (core, test_rb_new);
+    tcase_add_test (core, test_rb_node);
+    tcase_add_test (core, test_rb_new_ex);
+    tcase_add_test (core, test_rb_intrusive);
     tcase_add_test (core, test_rb_insert);
+    tcase_add_test (core, test_rb_build_sorted);
+    tcase_add_test (core, test_rb_build);
     tcase_add_test (core, test_rb_find);
+    tcase_add_test (core, test_rb_bound);
+    tcase_add_test (core, test_rb_range);
+    tcase_add_test (core, test_rb_rank);
+    tcase_add_test (core, test_rb_augment);
+    tcase_add_test (core, test_rb_batch);
     tcase_add_test (core, test_rb_remove);
+    tcase_add_test (core, test_rb_join);
+    tcase_add_test (core, test_rb_set);
+    tcase_add_test (core, test_rb_map);
+    tcase_add_test (core, test_rb_multi);
+    tcase_add_test (core, test_rb_pop);
+    tcase_add_test (core, test_rb_topdown);
+    tcase_add_test (core, test_rb_stats);
     tcase_add_test (core, test_rb_size);
     tcase_add_test (core, test_rb_empty);
 
@@ -0,0 +1,262 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2023 Mathieu Rabine
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// rbtree.
+#include <rbversion.h>
+
+// libraries.
+#include <check.h>
+
+// C.
+#include <stdlib.h>
+
+int compare (const void* left, const void* right)
+{
+    return (*(int*)(left) == *(int*)(right)) ? 0 : ((*(int*)(left) < *(int*)(right)) ? -1 : 1);
+}
+
+int black_height (const struct rbvnode* node)
+{
+    if (node == NULL)
+    {
+        return 1;
+    }
+
+    /* no red node with a red child, and the same black count on every path */
+    if (node->red)
+    {
+        ck_assert (node->link[0] == NULL || !node->link[0]->red);
+        ck_assert (node->link[1] == NULL || !node->link[1]->red);
+    }
+
+    int left = black_height (node->link[0]);
+    ck_assert_int_eq (left, black_height (node->link[1]));
+
+    return left + !node->red;
+}
+
+void check_version (const struct rbversion* version, const int* present, int n)
+{
+    struct rbvsiter it;
+    int count = 0, prev = -1;
+
+    ck_assert (version->root == NULL || !version->root->red);
+    black_height (version->root);
+
+    for (int* data = vs_beg (&it, version); data != NULL; data = vs_next (&it))
+    {
+        ck_assert_int_gt (*data, prev);
+        ck_assert (present[*data]);
+        prev = *data;
+        ++count;
+    }
+
+    ck_assert_int_eq (count, rb_version_size (version));
+
+    for (int i = 0; i < n; ++i)
+    {
+        int* found = rb_version_find (&i, version);
+        ck_assert (present[i] ? (found != NULL && *found == i) : found == NULL);
+    }
+}
+
+START_TEST (test_rb_version_new)
+{
+    struct rbversion* version = rb_version_new (compare);
+    struct rbvsiter it;
+    int key = 1;
+
+    ck_assert_ptr_ne (version, NULL);
+    ck_assert_int_eq (rb_version_size (version), 0);
+    ck_assert_ptr_eq (rb_version_find (&key, version), NULL);
+    ck_assert_ptr_eq (vs_beg (&it, version), NULL);
+    ck_assert_ptr_eq (vs_next (&it), NULL);
+    ck_assert_ptr_eq (vs_seek (&it, version, &key), NULL);
+
+    /* removing a missing element yields an equal version */
+    struct rbversion* same = rb_version_remove (&key, version);
+    ck_assert_ptr_ne (same, NULL);
+    ck_assert_int_eq (rb_version_size (same), 0);
+
+    struct rbversion* one = rb_version_insert (&key, version);
+    ck_assert_int_eq (rb_version_size (one), 1);
+    ck_assert_ptr_eq (rb_version_insert (&key, one), NULL);
+    ck_assert_ptr_eq (rb_version_find (&key, one), &key);
+    ck_assert_ptr_eq (rb_version_find (&key, version), NULL);
+
+    rb_version_delete (version);
+    rb_version_delete (same);
+    rb_version_delete (one);
+    rb_version_delete (NULL);
+}
+END_TEST
+
+START_TEST (test_rb_version_snapshot)
+{
+    enum { N = 300 };
+    static int vals[N], present[N + 1][N];
+    struct rbversion* versions[N + 1];
+
+    for (int i = 0; i < N; ++i)
+        vals[i] = i;
+
+    /* each version adds one element, every older one must stay intact */
+    versions[0] = rb_version_new (compare);
+
+    for (int i = 0; i < N; ++i)
+    {
+        int key = (i * 71) % N;
+
+        for (int j = 0; j < N; ++j)
+            present[i + 1][j] = present[i][j];
+        present[i + 1][key] = 1;
+
+        versions[i + 1] = rb_version_insert (&vals[key], versions[i]);
+        ck_assert_ptr_ne (versions[i + 1], NULL);
+    }
+
+    for (int i = 0; i <= N; i += 7)
+        check_version (versions[i], present[i], N);
+
+    /* drop every other version, the rest still share what they need */
+    for (int i = 1; i <= N; i += 2)
+        rb_version_delete (versions[i]);
+
+    for (int i = 0; i <= N; i += 2)
+        check_version (versions[i], present[i], N);
+
+    /* a snapshot outlives its origin */
+    struct rbversion* snapshot = rb_version_snapshot (versions[N]);
+
+    for (int i = 0; i <= N; i += 2)
+        rb_version_delete (versions[i]);
+
+    check_version (snapshot, present[N], N);
+    rb_version_delete (snapshot);
+}
+END_TEST
+
+START_TEST (test_rb_version_remove)
+{
+    enum { N = 500 };
+    static int vals[N], present[N], before[N];
+
+    struct rbversion* version = rb_version_new (compare);
+
+    for (int i = 0; i < N; ++i)
+    {
+        vals[i] = i;
+        present[i] = 1;
+
+        struct rbversion* next = rb_version_insert (&vals[i], version);
+        rb_version_delete (version);
+        version = next;
+    }
+
+    struct rbversion* full = rb_version_snapshot (version);
+
+    for (int i = 0; i < N; ++i)
+        before[i] = present[i];
+
+    /* remove in scattered order, checking both the new and the original version */
+    for (int i = 0; i < N; ++i)
+    {
+        int key = (i * 137) % N;
+
+        struct rbversion* next = rb_version_remove (&key, version);
+        ck_assert_ptr_ne (next, NULL);
+        rb_version_delete (version);
+        version = next;
+        present[key] = 0;
+
+        if (i % 23 == 0)
+        {
+            check_version (version, present, N);
+            check_version (full, before, N);
+        }
+    }
+
+    ck_assert_int_eq (rb_version_size (version), 0);
+    ck_assert_int_eq (rb_version_size (full), N);
+
+    rb_version_delete (version);
+    rb_version_delete (full);
+}
+END_TEST
+
+START_TEST (test_vs_seek)
+{
+    static int vals[100];
+    struct rbversion* version = rb_version_new (compare);
+    struct rbvsiter it;
+
+    for (int i = 0; i < 100; ++i)
+    {
+        vals[i] = 2 * i;
+
+        struct rbversion* next = rb_version_insert (&vals[i], version);
+        rb_version_delete (version);
+        version = next;
+    }
+
+    for (int key = -1; key < 199; ++key)
+    {
+        int* data = vs_seek (&it, version, &key);
+        int expected = (key < 0) ? 0 : key + (key & 1);
+
+        ck_assert_int_eq (*data, expected);
+        ck_assert_ptr_eq (vs_cur (&it), data);
+
+        /* walk to the end from there */
+        for (; data != NULL; data = vs_next (&it), expected += 2)
+            ck_assert_int_eq (*data, expected);
+        ck_assert_int_eq (expected, 200);
+    }
+
+    int key = 199;
+    ck_assert_ptr_eq (vs_seek (&it, version, &key), NULL);
+
+    rb_version_delete (version);
+}
+END_TEST
+
+int main (void)
+{
+    Suite* s = suite_create ("rbversion");
+    TCase* core = tcase_create ("core");
+
+    suite_add_tcase (s, core);
+    tcase_add_test (core, test_rb_version_new);
+    tcase_add_test (core, test_rb_version_snapshot);
+    tcase_add_test (core, test_rb_version_remove);
+    tcase_add_test (core, test_vs_seek);
+
+    SRunner* runner = srunner_create (s);
+    srunner_set_fork_status (runner, CK_NOFORK);
+    srunner_run_all (runner, CK_ENV);
+    int nf = srunner_ntests_failed (runner);
+    srunner_free (runner);
+
+    return nf == 0 ? 0 : 1;
+}